@@ -2,14 +2,15 @@
 #define __ISOTP_CONFIG__
 
 /* Max number of messages the receiver can receive at one time, this value 
- * is affectied by can driver queue length
+ * is affectied by can driver queue length. This and the parameters below up to
+ * the padding are defaults, links may have their own, see isotp_set_params.
  */
 #define ISO_TP_DEFAULT_BLOCK_SIZE           ( 8 )
 
 /* The STmin parameter value specifies the minimum time gap allowed between 
  * the transmission of consecutive frame network protocol data units
  *
- *  [ 0x00 – 0x7F ] 0ms - 127 ms; [ 0xF1 - 0xF9 ] 100ms - 900ms
+ *  0 - 127 ms, sub-millisecond values need a parameter block of their own
  */
 #define ISO_TP_DEFAULT_ST_MIN_MS            ( 0 ) 
 
@@ -27,6 +28,19 @@
  */
 #define ISO_TP_FRAME_PADDING                 ( 0 )
 
+/* Value of the padding bytes, also used to fill CAN FD frames up to a valid data length.
+ */
+#define ISO_TP_FRAME_PADDING_BYTE            ( 0x00 )
+
+/* Largest CAN frame handled, 8 for classic CAN only, 64 for CAN FD.
+ * The data length a link sends with is chosen by isotp_set_tx_dl.
+ */
+#define ISO_TP_MAX_FRAME_SIZE                ( 64 )
+
+/* Use the global isotp_user_* functions as transport of links without own ops.
+ */
+#define ISO_TP_USER_DEFAULT_OPS              ( 1 )
+
 /* Private. Size internal buffer for debud logger
 */
 #define ISP_TP_BUFFER_DEBUG_SIZE             ( 128 )
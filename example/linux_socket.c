@@ -4,6 +4,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>   
+#include <poll.h>
 
 #include <net/if.h>
 #include <sys/ioctl.h>
@@ -21,96 +22,113 @@
 #define SEC_TO_US(sec) ((sec)*1000000)
 
 /* Alloc IsoTpLink statically in RAM */
-static IsoTpLink *g_link = NULL;
+static IsoTpLink g_linkStorage;
+static IsoTpLink *g_link = &g_linkStorage;
 /* Alloc send and receive buffer statically in RAM */
 uint8_t g_isotpRecvBuf[ _ISOTP_BUFSIZE ];
 uint8_t g_isotpSendBuf[ _ISOTP_BUFSIZE ]; 
 
-static int _socket;
+/* Per-bus transport context, passed to the ops of every link on the bus */
+typedef struct {
+    int socket;
+} CanBus;
 
-void isotp_user_debug(const char* message);
-int  isotp_user_send_can(const uint32_t arbitration_id,
-                         const uint8_t* data, const uint8_t size);
-uint32_t isotp_user_get_us(void);
+static CanBus g_bus;
+
+static void can_bus_debug(void *ctx, const char* message);
+static int  can_bus_send_can(void *ctx, const uint32_t arbitration_id,
+                             const uint8_t* data, const uint8_t size);
+static uint32_t can_bus_get_us(void *ctx);
+
+static const IsoTpUserOps g_can_bus_ops = {
+    can_bus_send_can,
+    can_bus_get_us,
+    can_bus_debug,
+};
+
+static void on_indication(IsoTpLink *link, void *ctx, int result,
+                          const uint8_t *payload, uint32_t size);
+
+static const IsoTpCallbacks g_callbacks = {
+    on_indication,
+    NULL,
+    NULL,
+    NULL,
+};
 
 int main(int argc , char **argv)
 {
-    int i; 
     int nbytes;
 	struct sockaddr_can addr;
 	struct ifreq ifr;
 	struct can_frame frame;
 
+	(void) argc;
+	(void) argv;
 	printf("CAN Sockets Demo\r\n");
 
-    _socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    g_bus.socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
 
-	if ( _socket < 0) 
+	if ( g_bus.socket < 0) 
     {
 		perror("Socket");
 		return 1;
 	}
 
 	strcpy(ifr.ifr_name, _CAN_INTERFACE );
-	ioctl(_socket, SIOCGIFINDEX, &ifr);
+	ioctl(g_bus.socket, SIOCGIFINDEX, &ifr);
 
 	memset(&addr, 0, sizeof(addr));
 	addr.can_family = AF_CAN;
 	addr.can_ifindex = ifr.ifr_ifindex;
 
-	if (bind(_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+	if (bind(g_bus.socket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
 		perror("Bind");
 		return 1;
 	}
 
     /* Init ISOTP lib */
     /* Initialize link, ISOTP_CAN_ID is the CAN ID you send with */
-    g_link = isotp_init_link(_ISOTP_CAN_ID,
+    isotp_init_link_static(g_link, _ISOTP_CAN_ID,
 						g_isotpSendBuf, sizeof(g_isotpSendBuf), 
 						g_isotpRecvBuf, sizeof(g_isotpRecvBuf)); 
-    if( g_link == NULL )
-    {
-        perror("ISOTP");
-        return 1;
-    }
+    isotp_set_user_ops(g_link, &g_can_bus_ops, &g_bus);
+    isotp_set_callbacks(g_link, &g_callbacks, NULL);
 
 	while( true )
     {
-        nbytes = read(_socket, &frame, sizeof(struct can_frame));  
+        /* sleep until a frame arrives or the link needs polling */
+        struct pollfd pfd = { g_bus.socket, POLLIN, 0 };
+        int timeout_ms = -1;
+        uint32_t deadline_us;
+        if( isotp_next_deadline(g_link, &deadline_us) == ISOTP_RET_OK )
+        {
+            const int32_t wait_us = (int32_t)(deadline_us - can_bus_get_us(&g_bus));
+            timeout_ms = wait_us > 0 ? (wait_us + 999) / 1000 : 0;
+        }
+
+        if( poll(&pfd, 1, timeout_ms) <= 0 )
+        {
+            isotp_poll( g_link );
+            continue;
+        }
+
+        nbytes = read(g_bus.socket, &frame, sizeof(struct can_frame));  
         if (nbytes < 0) 
         {
             perror("Read");
             break;
         }
 
-        int ret = isotp_on_can_message(g_link, frame.data, frame.can_dlc ); 
-        if( ret == ISOTP_RET_OK)
+        /* complete messages are reported through on_indication */
+        if( isotp_on_can_message(g_link, frame.data, frame.can_dlc ) == ISOTP_RET_OK )
         {
             isotp_poll( g_link );
-
-            if( g_link->receive_status == ISOTP_RECEIVE_STATUS_FULL )
-            {
-                uint8_t payload[ _ISOTP_BUFSIZE ] = { 0 };
-                uint16_t out_size = 0;
-                ret = isotp_receive(g_link, payload, sizeof( payload ), &out_size);
-                if( ret == ISOTP_RET_OK )
-                {
-
-                    printf("0x%03X [%d] ",frame.can_id, out_size);
-
-                    for (i = 0; i < out_size; i++)
-                        printf("%02X ",payload[i]);
-
-                    printf("\r\n");
-                }
-            }
         }
 
     }
 
-    free( g_link ); 
-
-	if (close( _socket ) < 0) {
+	if (close( g_bus.socket ) < 0) {
 		perror("Close");
 		return 1;
 	}
@@ -118,14 +136,42 @@ int main(int argc , char **argv)
 	return 0;    
 }
 
-void isotp_user_debug(const char* message)
+static void on_indication(IsoTpLink *link, void *ctx, int result,
+                          const uint8_t *payload, uint32_t size)
+{
+    uint32_t i;
+    (void) ctx;
+
+    if( result != ISOTP_PROTOCOL_RESULT_OK )
+    {
+        fprintf( stderr, "Receive failed: %d\r\n", result );
+        return;
+    }
+
+    /* parse in place, then free the buffer for the next message */
+    if( isotp_receive_lease(link, &payload, &size) == ISOTP_RET_OK )
+    {
+        printf("0x%03X [%lu] ", link->receive_arbitration_id, (unsigned long) size);
+
+        for (i = 0; i < size; i++)
+            printf("%02X ",payload[i]);
+
+        printf("\r\n");
+
+        isotp_receive_release(link);
+    }
+}
+
+static void can_bus_debug(void *ctx, const char* message)
 {
+  (void) ctx;
   fprintf( stderr, "%s", message );
 }
 
-int  isotp_user_send_can(const uint32_t arbitration_id,
-                         const uint8_t* data, const uint8_t size)
+static int  can_bus_send_can(void *ctx, const uint32_t arbitration_id,
+                             const uint8_t* data, const uint8_t size)
 {
+    CanBus *bus = (CanBus *)ctx;
     int ret = ISOTP_RET_ERROR;
 
     struct can_frame frame;
@@ -135,7 +181,7 @@ int  isotp_user_send_can(const uint32_t arbitration_id,
 
     memcpy( frame.data, data, size );
 	
-    ssize_t ret_size = write(_socket, &frame, sizeof(struct can_frame));
+    ssize_t ret_size = write(bus->socket, &frame, sizeof(struct can_frame));
 
 	if (ret_size == sizeof(struct can_frame)) 
     {		
@@ -145,8 +191,10 @@ int  isotp_user_send_can(const uint32_t arbitration_id,
     return ret; /* TODO: Check return value */ 
 }
 
-uint32_t isotp_user_get_us(void)
+static uint32_t can_bus_get_us(void *ctx)
 {
+    (void) ctx;
+
     uint64_t microsecond;
     struct timespec ts;
     int return_code = timespec_get(&ts, TIME_UTC);
@@ -159,8 +207,32 @@ uint32_t isotp_user_get_us(void)
     {
         // `ts` now contains your timestamp in seconds and microseconds! To 
         // convert the whole struct to microseconds, do this:
-        microsecond = SEC_TO_US((uint64_t)ts.tv_sec) + (uint64_t)ts.tv_nsec;
+        microsecond = SEC_TO_US((uint64_t)ts.tv_sec) + (uint64_t)ts.tv_nsec / 1000;
     }
 
   return (uint32_t)microsecond;
-}
\ No newline at end of file
+}
+
+#if ISO_TP_USER_DEFAULT_OPS
+/* libisotp is built with the legacy backend. Every link here has its own ops,
+ * so these are never called and only satisfy the linker.
+ */
+void isotp_user_debug(const char* message)
+{
+    can_bus_debug(NULL, message);
+}
+
+int  isotp_user_send_can(const uint32_t arbitration_id,
+                         const uint8_t* data, const uint8_t size)
+{
+    (void) arbitration_id;
+    (void) data;
+    (void) size;
+    return ISOTP_RET_ERROR;
+}
+
+uint32_t isotp_user_get_us(void)
+{
+    return can_bus_get_us(NULL);
+}
+#endif
@@ -1,50 +1,138 @@
 #include <stdint.h>
-#include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
 
 #include "isotp.h"
+#include "isotp_timer.h"
+#include "isotp_codec.h"
+#include "isotp_classify.h"
+
+#if !ISO_TP_NO_HEAP
+#include <stdlib.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#endif
+
+/* layout of IsoTpLink, see isotp.h */
+ISOTP_STATIC_ASSERT(sizeof(IsoTpLink) <= ISO_TP_LINK_SIZE_BUDGET, link_size_budget);
+#if defined(__GNUC__) || defined(_MSC_VER)
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, send_status) % ISOTP_CACHE_LINE_SIZE == 0, link_tx_aligned);
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, receive_status) % ISOTP_CACHE_LINE_SIZE == 0, link_rx_aligned);
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, timer) % ISOTP_CACHE_LINE_SIZE == 0, link_timer_aligned);
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, user_ops) % ISOTP_CACHE_LINE_SIZE == 0, link_shared_aligned);
+#endif
+#if ISOTP_CACHE_LINE_SIZE >= 64
+/* the per frame fields of each direction share one line */
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, send_iov_count) + sizeof(uint16_t) <= ISOTP_CACHE_LINE_SIZE, link_tx_hot);
+ISOTP_STATIC_ASSERT(offsetof(IsoTpLink, receive_buf_size) + sizeof(uint32_t) - offsetof(IsoTpLink, receive_status) <= ISOTP_CACHE_LINE_SIZE, link_rx_hot);
+#endif
 
 ///////////////////////////////////////////////////////
 ///                 STATIC FUNCTIONS                ///
 ///////////////////////////////////////////////////////
 
-void isotp_debug(const char* message, ...)
+/* parameters of links without own ones */
+static const IsoTpLinkParams isotp_default_params = ISOTP_LINK_PARAMS_DEFAULT;
+
+#if ISO_TP_USER_DEFAULT_OPS
+
+/* legacy backend, forwards to the global user shims */
+static int isotp_default_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
+{
+    (void) ctx;
+    return isotp_user_send_can(arbitration_id, data, size);
+}
+
+static uint32_t isotp_default_get_us(void *ctx)
+{
+    (void) ctx;
+    return isotp_user_get_us();
+}
+
+static void isotp_default_debug(void *ctx, const char* message)
+{
+    (void) ctx;
+    isotp_user_debug(message);
+}
+
+const IsoTpUserOps isotp_user_default_ops = {
+    isotp_default_send_can,
+    isotp_default_get_us,
+    isotp_default_debug,
+};
+
+#endif
+
+static void isotp_debug(IsoTpLink *link, const char* message, ...)
+{
+    const IsoTpUserOps *ops = NULL;
+    void *ctx = NULL;
+
+    if (link != NULL) 
+    {
+        ops = link->user_ops;
+        ctx = link->user_ctx;
+
+    } else {
+#if ISO_TP_USER_DEFAULT_OPS
+        ops = &isotp_user_default_ops;
+#endif
+    }
+
+    /* debug output is optional */
+    if (ops != NULL && ops->debug != NULL) 
+    {
+        va_list args;
+        va_start( args, message );
+
+        char debugbuff[ ISP_TP_BUFFER_DEBUG_SIZE ];
+        vsnprintf(debugbuff, sizeof(debugbuff), message, args);
+
+        ops->debug(ctx, debugbuff);
+
+        va_end( args );
+    }
+}
+
+static int isotp_link_send_can(IsoTpLink *link, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
 {
-    va_list args;
-	va_start( args, message );
+    assert( link->user_ops != NULL );
 
-    char debugbuff[ ISP_TP_BUFFER_DEBUG_SIZE ];
-    vsnprintf(debugbuff, sizeof(debugbuff), message, args);
+    return link->user_ops->send_can(link->user_ctx, arbitration_id, data, size);
+}
 
-    isotp_user_debug(debugbuff);
+static uint32_t isotp_link_get_us(IsoTpLink *link)
+{
+    assert( link->user_ops != NULL );
 
-    va_end( args );
+    return link->user_ops->get_us(link->user_ctx);
 }
 
 /* st_ms to microsecond */
-static uint8_t isotp_us_to_st_ms(uint32_t us) 
+static uint8_t isotp_us_to_st_ms(IsoTpLink *link, uint32_t us) 
 {
     uint32_t time_min = 0;
 
-    if (us <= 127000) 
+    if (us >= 1000 && us <= 127000) 
     {
         time_min = us / 1000;
 
-    } else if (us >= 100000 && us <= 900000) {
+    } else if (us < 1000) {
 
-        time_min = 0xF0 + (us / 100000);
+        /* 0xF1 - 0xF9 are 100 - 900 microseconds */
+        time_min = (us >= 100) ? 0xF0 + (us / 100) : 0;
 
     } else {
 
-        isotp_debug("This range of values is reserved by part of ISO 15765\n");
+        isotp_debug(link, "This range of values is reserved by part of ISO 15765\n");
     }
 
     return time_min;
 }
 
 /* st_ms to usec  */
-static uint32_t isotp_st_ms_to_us(uint16_t st_ms) 
+static uint32_t isotp_st_ms_to_us(IsoTpLink *link, uint16_t st_ms) 
 {
     uint32_t time_us = 0;
 
@@ -54,43 +142,133 @@ static uint32_t isotp_st_ms_to_us(uint16_t st_ms)
 
     } else if (st_ms >= 0xF1 && st_ms <= 0xF9) {
 
-        time_us = (st_ms - 0xF0) * 100000;
+        time_us = (st_ms - 0xF0) * 100;
 
     } else {
 
-        isotp_debug("This range of values is reserved by part of ISO 15765\n");
+        isotp_debug(link, "This range of values is reserved by part of ISO 15765\n");
     }
 
     return time_us;
 }
 
+/* smallest CAN data length holding len bytes, CAN FD only knows a few above 8 */
+static uint8_t isotp_can_dl(uint8_t len) 
+{
+    static const uint8_t fd_dls[] = { 12, 16, 20, 24, 32, 48, 64 };
+    uint8_t dl = len;
+
+    if (len > 8) 
+    {
+        for (uint8_t index = 0; index < sizeof(fd_dls); index++) 
+        {
+            if (len <= fd_dls[index]) 
+            {
+                dl = fd_dls[index];
+                break;
+            }
+        }
+    }
+
+    return dl;
+}
+
+/* max single frame payload of a data length, frames above 8 bytes need the escape byte */
+static uint8_t isotp_sf_max(uint8_t dl) 
+{
+    return dl <= 8 ? dl - 1 : dl - 2;
+}
+
+/* pad a frame of len bytes to a valid CAN data length and send it */
+static int isotp_send_frame(IsoTpLink* link, uint32_t id, uint8_t *frame, uint8_t len) 
+{
+    uint8_t dl = isotp_can_dl(len);
+
+    if (link->params->padding && dl < 8) 
+    {
+        dl = 8;
+    }
+    (void) memset(frame + len, link->params->padding_byte, dl - len);
+
+    return isotp_link_send_can(link, id, frame, dl);
+}
+
 static int isotp_send_flow_control(IsoTpLink* link, uint8_t flow_status, uint8_t block_size, uint32_t st_min_us) 
 {
     assert( link != NULL );
 
-    IsoTpCanMessage message;
+    uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
     int ret = ISOTP_RET_ERROR;
 
     /* setup message  */
-    message.as.flow_control.type = ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME;
-    message.as.flow_control.FS = flow_status;
-    message.as.flow_control.BS = block_size;
-    message.as.flow_control.STmin = isotp_us_to_st_ms(st_min_us);
+    isotp_codec_put_fc(frame, flow_status, block_size, isotp_us_to_st_ms(link, st_min_us));
 
     /* send message */
-#if ISO_TP_FRAME_PADDING  
-    (void) memset(message.as.flow_control.reserve, 0, sizeof(message.as.flow_control.reserve));
-    ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, sizeof(message));
-#else    
-    ret = isotp_user_send_can(link->send_arbitration_id,
-            message.as.data_array.ptr,
-            3);
-#endif
+    ret = isotp_send_frame(link, link->send_arbitration_id, frame, 3);
 
     if( ret != ISOTP_RET_OK )
     {
         ret = ISOTP_RET_HW_NOTREADY;
-        isotp_debug("The attempt to send flow control ended with an error: [ %d ]\n", ret );
+        isotp_debug(link, "The attempt to send flow control ended with an error: [ %d ]\n", ret );
+    }
+
+    return ret;
+}
+
+/* copy size bytes at send_offset out of the segments, resuming at the last segment used */
+static void isotp_send_gather(IsoTpLink* link, uint8_t *data, uint32_t size) 
+{
+    uint32_t offset = link->send_offset;
+
+    if (offset < link->send_iov_base) 
+    {
+        link->send_iov_index = 0;
+        link->send_iov_base = 0;
+    }
+
+    while (size > 0) 
+    {
+        assert( link->send_iov_index < link->send_iov_count );
+
+        const IsoTpIoVec *segment = &link->send_iov[link->send_iov_index];
+        const uint32_t segment_offset = offset - link->send_iov_base;
+
+        if (segment_offset >= segment->len) 
+        {
+            link->send_iov_base += segment->len;
+            link->send_iov_index += 1;
+
+        } else {
+
+            uint32_t copylen = segment->len - segment_offset;
+            if (copylen > size) 
+            {
+                copylen = size;
+            }
+            (void) memcpy(data, (const uint8_t *)segment->base + segment_offset, copylen);
+            data += copylen;
+            offset += copylen;
+            size -= copylen;
+        }
+    }
+}
+
+/* copy the next size bytes of the message, from memory, segments or the producer */
+static int isotp_send_fetch(IsoTpLink* link, uint8_t *data, uint32_t size) 
+{
+    int ret = ISOTP_RET_OK;
+
+    if (link->send_producer != NULL) 
+    {
+        ret = link->send_producer(link, link->send_producer_ctx, data, link->send_offset, size);
+
+    } else if (link->send_iov != NULL) {
+
+        isotp_send_gather(link, data, size);
+
+    } else {
+
+        (void) memcpy(data, link->send_payload + link->send_offset, size);
     }
 
     return ret;
@@ -100,31 +278,36 @@ static int isotp_send_single_frame(IsoTpLink* link, uint32_t id)
 {
     assert( link != NULL );
 
-    IsoTpCanMessage message;
+    uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
+    uint8_t pci_length = 1;
     int ret = ISOTP_RET_ERROR;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size <= 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size <= isotp_sf_max(link->send_tx_dl));
 
     /* setup message  */
-    message.as.single_frame.type = ISOTP_PCI_TYPE_SINGLE;
-    message.as.single_frame.SF_DL = (uint8_t) link->send_size;
-    (void) memcpy(message.as.single_frame.data, link->send_buffer, link->send_size);
+    if (link->send_size <= 7) 
+    {
+        isotp_codec_put_pci(frame, ISOTP_PCI_TYPE_SINGLE, (uint8_t) link->send_size);
 
-    /* send message */
-#if ISO_TP_FRAME_PADDING
-    (void) memset(message.as.single_frame.data + link->send_size, 0, sizeof(message.as.single_frame.data) - link->send_size);
-    ret = isotp_user_send_can(id, message.as.data_array.ptr, sizeof(message));
-#else
-    ret = isotp_user_send_can(id,
-            message.as.data_array.ptr,
-            link->send_size + 1);
-#endif
+    } else {
+
+        /* CAN FD escape, the length moves to the second byte */
+        isotp_codec_put_pci(frame, ISOTP_PCI_TYPE_SINGLE, 0);
+        frame[ISOTP_CODEC_SF_ESC_DL] = (uint8_t) link->send_size;
+        pci_length = 2;
+    }
+    ret = isotp_send_fetch(link, frame + pci_length, link->send_size);
 
-    if(ret != ISOTP_RET_OK)
+    /* send message */
+    if (ISOTP_RET_OK == ret) 
     {
-        ret = ISOTP_RET_HW_NOTREADY;
-        isotp_debug("The attempt to send single frame ended with an error: [ %d ]\n", ret );
+        ret = isotp_send_frame(link, id, frame, (uint8_t) (link->send_size + pci_length));
+        if(ret != ISOTP_RET_OK)
+        {
+            ret = ISOTP_RET_HW_NOTREADY;
+            isotp_debug(link, "The attempt to send single frame ended with an error: [ %d ]\n", ret );
+        }
     }
 
     return ret;
@@ -134,29 +317,33 @@ static int isotp_send_first_frame(IsoTpLink* link, uint32_t id)
 {
     assert( link != NULL );
 
-    IsoTpCanMessage message;
+    uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
+    uint8_t data_length = 0;
+    uint8_t pci_length = 0;
     int ret = ISOTP_RET_ERROR;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_sf_max(link->send_tx_dl));
 
-    /* setup message  */
-    message.as.first_frame.type = ISOTP_PCI_TYPE_FIRST_FRAME;
-    message.as.first_frame.FF_DL_low = (uint8_t) link->send_size;
-    message.as.first_frame.FF_DL_high = (uint8_t) (0x0F & (link->send_size >> 8));
-    (void) memcpy(message.as.first_frame.data, link->send_buffer, sizeof(message.as.first_frame.data));
+    /* setup message, a 32 bit FF_DL is escaped behind a zero 12 bit one */
+    pci_length = isotp_codec_put_ff(frame, link->send_size);
+    data_length = link->send_tx_dl - pci_length;
+    ret = isotp_send_fetch(link, frame + pci_length, data_length);
 
     /* send message */
-    ret = isotp_user_send_can(id, message.as.data_array.ptr, sizeof(message));
     if (ISOTP_RET_OK == ret) 
     {
-        link->send_offset += sizeof(message.as.first_frame.data);
-        link->send_sn = 1;
+        ret = isotp_send_frame(link, id, frame, link->send_tx_dl);
+        if (ISOTP_RET_OK == ret) 
+        {
+            link->send_offset += data_length;
+            link->send_sn = 1;
 
-    } else {
+        } else {
 
-        ret = ISOTP_RET_HW_NOTREADY;    
-        isotp_debug("The attempt to send first frame ended with an error: [ %d ]\n", ret );
+            ret = ISOTP_RET_HW_NOTREADY;    
+            isotp_debug(link, "The attempt to send first frame ended with an error: [ %d ]\n", ret );
+        }
     }
 
     return ret;
@@ -166,65 +353,74 @@ static int isotp_send_consecutive_frame(IsoTpLink* link)
 {
     assert( link != NULL );
 
-    IsoTpCanMessage message;
-    uint16_t data_length;
+    uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
+    uint32_t data_length;
     int ret = ISOTP_RET_ERROR;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_sf_max(link->send_tx_dl));
 
     /* setup message  */
-    message.as.consecutive_frame.type = TSOTP_PCI_TYPE_CONSECUTIVE_FRAME;
-    message.as.consecutive_frame.SN = link->send_sn;
+    isotp_codec_put_pci(frame, TSOTP_PCI_TYPE_CONSECUTIVE_FRAME, link->send_sn);
     data_length = link->send_size - link->send_offset;
-    if (data_length > sizeof(message.as.consecutive_frame.data)) {
-        data_length = sizeof(message.as.consecutive_frame.data);
+    if (data_length > (uint32_t) (link->send_tx_dl - 1)) {
+        data_length = (uint32_t) (link->send_tx_dl - 1);
     }
-    (void) memcpy(message.as.consecutive_frame.data, link->send_buffer + link->send_offset, data_length);
+    ret = isotp_send_fetch(link, frame + 1, data_length);
 
     /* send message */
-#if ISO_TP_FRAME_PADDING
-    (void) memset(message.as.consecutive_frame.data + data_length, 0, sizeof(message.as.consecutive_frame.data) - data_length);
-    ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, sizeof(message));
-#else
-    ret = isotp_user_send_can(link->send_arbitration_id,
-            message.as.data_array.ptr,
-            data_length + 1);
-#endif
     if (ISOTP_RET_OK == ret) 
     {
-        link->send_offset += data_length;
-        if (++(link->send_sn) > 0x0F) {
-            link->send_sn = 0;
-        }
+        ret = isotp_send_frame(link, link->send_arbitration_id, frame, (uint8_t) (data_length + 1));
+        if (ISOTP_RET_OK == ret) 
+        {
+            link->send_offset += data_length;
+            if (++(link->send_sn) > 0x0F) {
+                link->send_sn = 0;
+            }
 
-    } else {
+        } else {
 
-        ret = ISOTP_RET_HW_NOTREADY;    
-        isotp_debug("The attempt to send consecutive frame ended with an error: [ %d ]\n", ret );
+            ret = ISOTP_RET_HW_NOTREADY;    
+            isotp_debug(link, "The attempt to send consecutive frame ended with an error: [ %d ]\n", ret );
+        }
     }
     
     return ret;
 }
 
-static int isotp_receive_single_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) 
+static int isotp_receive_single_frame(IsoTpLink *link, const uint8_t *frame, uint8_t len, uint32_t sf_dl) 
 {
     assert( link != NULL );
-    assert( message != NULL );
+    assert( frame != NULL );
 
     int ret = ISOTP_RET_ERROR;
+    const uint8_t *data = frame + 1;
+    uint32_t max_dl = (uint32_t) len - 1;
+
+    /* CAN FD escape, the length follows the PCI byte */
+    if (len > 8) 
+    {
+        data += 1;
+        max_dl = (uint32_t) len - 2;
+    }
 
-    /* check data length */
-    if ((0 == message->as.single_frame.SF_DL) || (message->as.single_frame.SF_DL > (len - 1))) 
+    /* check data length, frames longer than 8 bytes must not have SF_DL in the nibble */
+    if ((0 == sf_dl) || (sf_dl > max_dl) || (len > 8 && 0 != isotp_codec_nibble(frame))) 
     {
         ret = ISOTP_RET_LENGTH;
-        isotp_debug("Single-frame length too small.\n");
+        isotp_debug(link, "Single-frame length invalid.\n");
+
+    } else if (sf_dl > link->receive_buf_size) {
+
+        ret = ISOTP_RET_OVERFLOW;
+        isotp_debug(link, "Single-frame too large for receiving buffer.\n");
 
     } else {
 
         /* copying data */
-        (void) memcpy(link->receive_buffer, message->as.single_frame.data, message->as.single_frame.SF_DL);
-        link->receive_size = message->as.single_frame.SF_DL;
+        (void) memcpy((void *)link->receive_buffer, data, sf_dl);
+        link->receive_size = sf_dl;
 
         ret = ISOTP_RET_OK;
     }
@@ -232,42 +428,105 @@ static int isotp_receive_single_frame(IsoTpLink *link, IsoTpCanMessage *message,
     return ret;
 }
 
-static int isotp_receive_first_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) 
+/* receive data goes to on_receive_chunk, the receive buffer only stages it */
+static int isotp_streaming(const IsoTpLink *link) 
+{
+    return link->callbacks != NULL && link->callbacks->on_receive_chunk != NULL;
+}
+
+/* hand the staged chunk to the sink */
+static void isotp_stream_flush(IsoTpLink *link) 
+{
+    const uint32_t size = link->receive_offset - link->receive_stream_offset;
+
+    if (size > 0) 
+    {
+        if (ISOTP_RET_INPROGRESS == link->callbacks->on_receive_chunk(link, link->callback_ctx,
+                (const uint8_t *)link->receive_buffer, link->receive_stream_offset, size)) 
+        {
+            link->receive_paused = 1;
+        }
+        link->receive_stream_offset = link->receive_offset;
+    }
+}
+
+/* stage received data, flushing whenever the receive buffer is full or the message complete */
+static void isotp_stream_write(IsoTpLink *link, const uint8_t *data, uint32_t size) 
+{
+    assert( link->receive_buf_size > 0 );
+
+    while (size > 0) 
+    {
+        const uint32_t fill = link->receive_offset - link->receive_stream_offset;
+        uint32_t copylen = link->receive_buf_size - fill;
+
+        if (copylen > size) 
+        {
+            copylen = size;
+        }
+        (void) memcpy((uint8_t *)link->receive_buffer + fill, data, copylen);
+        link->receive_offset += copylen;
+        data += copylen;
+        size -= copylen;
+
+        if (fill + copylen == link->receive_buf_size || link->receive_offset >= link->receive_size) 
+        {
+            isotp_stream_flush(link);
+        }
+    }
+}
+
+static int isotp_receive_first_frame(IsoTpLink *link, const uint8_t *frame, uint8_t len, uint32_t payload_length) 
 {
     assert( link != NULL );
-    assert( message != NULL );
+    assert( frame != NULL );
 
     int ret = ISOTP_RET_ERROR;
 
-    if (8 != len) 
+    /* a first frame fills the data length of the sender, RX_DL */
+    if (len < 8) 
     {
         ret = ISOTP_RET_LENGTH;
-        isotp_debug("First frame should be 8 bytes in length.\n");
+        isotp_debug(link, "First frame should be at least 8 bytes in length.\n");
 
     } else {
 
-        /* check data length */
-        uint16_t payload_length = message->as.first_frame.FF_DL_high;
-        payload_length = (payload_length << 8) + message->as.first_frame.FF_DL_low;
+        /* only lengths above 12 bit are escaped, the 32 bit FF_DL follows */
+        const uint8_t *data = frame + ((payload_length > ISOTP_MAX_FF_DL) ? 6 : 2);
 
         /* should not use multiple frame transmition */
-        if (payload_length <= 7) 
+        if (payload_length <= isotp_sf_max(len)) 
         {
             ret = ISOTP_RET_LENGTH;
-            isotp_debug("Should not use multiple frame transmission.\n");
+            isotp_debug(link, "Should not use multiple frame transmission.\n");
 
-        } else if (payload_length > link->receive_buf_size) {
+        } else if (payload_length > link->receive_buf_size && !isotp_streaming(link)) {
 
             ret = ISOTP_RET_OVERFLOW;
-            isotp_debug("Multi-frame response too large for receiving buffer.\n");
+            isotp_debug(link, "Multi-frame response too large for receiving buffer.\n");
 
         } else {
             
-            /* copying data */
-            (void) memcpy(link->receive_buffer, message->as.first_frame.data, sizeof(message->as.first_frame.data));
+            const uint32_t data_length = (uint32_t) (len - (data - frame));
+
             link->receive_size = payload_length;
-            link->receive_offset = sizeof(message->as.first_frame.data);
+            link->receive_rx_dl = len;
             link->receive_sn = 1;
+            link->receive_paused = 0;
+            link->receive_wait_count = 0;
+
+            /* copying data */
+            if (isotp_streaming(link)) 
+            {
+                link->receive_offset = 0;
+                link->receive_stream_offset = 0;
+                isotp_stream_write(link, data, data_length);
+
+            } else {
+
+                (void) memcpy((void *)link->receive_buffer, data, data_length);
+                link->receive_offset = data_length;
+            }
 
             ret = ISOTP_RET_OK;
         }
@@ -277,41 +536,48 @@ static int isotp_receive_first_frame(IsoTpLink *link, IsoTpCanMessage *message,
     return ret;
 }
 
-static int isotp_receive_consecutive_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) 
+static int isotp_receive_consecutive_frame(IsoTpLink *link, const uint8_t *frame, uint8_t len, uint8_t sn) 
 {
     assert( link != NULL );
-    assert( message != NULL );
+    assert( frame != NULL );
 
     int ret = ISOTP_RET_ERROR;
-    uint16_t remaining_bytes = 0;
+    uint32_t remaining_bytes = 0;
     
     /* check sn */
-    if (link->receive_sn != message->as.consecutive_frame.SN) 
+    if (link->receive_sn != sn) 
     {
         ret = ISOTP_RET_WRONG_SN;
-        isotp_debug("Wrong SN into the condecutive frame\n");
+        isotp_debug(link, "Wrong SN into the condecutive frame\n");
 
     } else {
 
         /* check data length */
         remaining_bytes = link->receive_size - link->receive_offset;
 
-        if (remaining_bytes > sizeof(message->as.consecutive_frame.data)) 
+        if (remaining_bytes > (uint32_t) (link->receive_rx_dl - 1)) 
         {
-            remaining_bytes = sizeof(message->as.consecutive_frame.data);
+            remaining_bytes = (uint32_t) (link->receive_rx_dl - 1);
         }
 
-        if (remaining_bytes > len - 1) 
+        if (remaining_bytes > (uint32_t) (len - 1)) 
         {
             ret = ISOTP_RET_LENGTH;
-            isotp_debug("Consecutive frame too short.\n");
+            isotp_debug(link, "Consecutive frame too short.\n");
 
         } else {
 
             /* copying data */
-            (void) memcpy(link->receive_buffer + link->receive_offset, message->as.consecutive_frame.data, remaining_bytes);
+            if (isotp_streaming(link)) 
+            {
+                isotp_stream_write(link, frame + 1, remaining_bytes);
+
+            } else {
+
+                (void) memcpy((uint8_t *)link->receive_buffer + link->receive_offset, frame + 1, remaining_bytes);
+                link->receive_offset += remaining_bytes;
+            }
 
-            link->receive_offset += remaining_bytes;
             if (++(link->receive_sn) > 0x0F) 
             {
                 link->receive_sn = 0;
@@ -324,10 +590,10 @@ static int isotp_receive_consecutive_frame(IsoTpLink *link, IsoTpCanMessage *mes
     return ret;
 }
 
-static int isotp_receive_flow_control_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) 
+static int isotp_receive_flow_control_frame(IsoTpLink *link, const uint8_t *frame, uint8_t len) 
 {
     assert( link != NULL );
-    assert( message != NULL );
+    assert( frame != NULL );
 
     int ret = ISOTP_RET_ERROR;
 
@@ -335,7 +601,7 @@ static int isotp_receive_flow_control_frame(IsoTpLink *link, IsoTpCanMessage *me
     if (len < 3) 
     {
         ret = ISOTP_RET_LENGTH;
-        isotp_debug("Flow control frame too short.\n");
+        isotp_debug(link, "Flow control frame too short.\n");
 
     } else {
 
@@ -345,299 +611,798 @@ static int isotp_receive_flow_control_frame(IsoTpLink *link, IsoTpCanMessage *me
     return ret;
 }
 
-///////////////////////////////////////////////////////
-///                 PUBLIC FUNCTIONS                ///
-///////////////////////////////////////////////////////
+/* N_USData.indication, the message is in the receive buffer when result is ok */
+static void isotp_indication(IsoTpLink *link, int result) 
+{
+    if (link->callbacks != NULL && link->callbacks->on_indication != NULL) 
+    {
+        link->callbacks->on_indication(link, link->callback_ctx, result,
+                ISOTP_RECEIVE_STATUS_FULL == link->receive_status ? (const uint8_t *)link->receive_buffer : NULL,
+                ISOTP_PROTOCOL_RESULT_OK == result ? link->receive_size : 0);
+    }
+}
 
-int isotp_send(IsoTpLink *link, const uint8_t payload[], uint16_t size) {
-    return isotp_send_with_id(link, link->send_arbitration_id, payload, size);
+/* hand the outcome of a send to the thread waiting on it */
+static void isotp_complete(IsoTpCompletion *completion, int status, int result) 
+{
+    completion->status = status;
+    completion->result = result;
+    ISOTP_STORE_RELEASE(&completion->done, 1);
 }
 
-int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size) 
+/* end of a send, N_USData.confirm */
+static void isotp_send_finish(IsoTpLink *link, uint8_t status, int result) 
 {
-    assert( link != NULL );
-    
-    int ret = ISOTP_RET_ERROR;
+    IsoTpCompletion *completion = link->send_completion;
 
-    if ( link == NULL ) 
+    link->send_status = status;
+    link->send_protocol_result = result;
+    link->send_completion = NULL;
+
+    if (completion != NULL) 
     {
-        isotp_debug("Link is null!\n");
-        ret = ISOTP_RET_ERROR;
+        isotp_complete(completion, ISOTP_RET_OK, result);
+    }
 
-    } else {
+    if (link->callbacks != NULL && link->callbacks->on_confirm != NULL) 
+    {
+        link->callbacks->on_confirm(link, link->callback_ctx, result);
+    }
+}
 
-        if (size > link->send_buf_size) 
+/* read the clock once, however many frames of a batch need it */
+static uint32_t isotp_clock_us(IsoTpLink *link, IsoTpClock *clock) 
+{
+    if (!clock->valid) 
+    {
+        clock->us = isotp_link_get_us(link);
+        clock->valid = 1;
+    }
+
+    return clock->us;
+}
+
+/* keep the timer of the link armed with its next deadline */
+static void isotp_timer_sync(IsoTpLink *link) 
+{
+    uint32_t deadline_us;
+
+    if (link->timer_wheel != NULL) 
+    {
+        if (ISOTP_RET_OK == isotp_next_deadline(link, &deadline_us)) 
         {
-            isotp_debug("Message size too large. Increase ISO_TP_MAX_MESSAGE_SIZE to set a larger buffer\n");
-            isotp_debug("Attempted to send %d bytes; max size is %d!\n", size, link->send_buf_size);
-            ret = ISOTP_RET_OVERFLOW;
+            isotp_timer_wheel_schedule(link->timer_wheel, &link->timer, deadline_us);
 
         } else {
 
-            if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
-            {
-                isotp_debug("Abort previous message, transmission in progress.\n");
-                ret = ISOTP_RET_INPROGRESS;
+            isotp_timer_wheel_cancel(link->timer_wheel, &link->timer);
+        }
+    }
+}
 
-            } else {
+/* clear the sender for the next block, or hold it with FC.WAIT while the stream sink is paused */
+static int isotp_receive_next_block(IsoTpLink *link, IsoTpClock *clock, int *protocol_result) 
+{
+    int ret = ISOTP_RET_ERROR;
 
-                /* copy into local buffer */
-                link->send_size = size;
-                link->send_offset = 0;
-                link->send_arbitration_id = id;
-                (void) memcpy(link->send_buffer, payload, size);
+    link->receive_bs_count = link->params->block_size;
 
-                if (link->send_size < 8) 
-                {
-                    /* send single frame */
-                    ret = isotp_send_single_frame(link, link->send_arbitration_id);
-                } else {
-                    /* send multi-frame */
-                    ret = isotp_send_first_frame(link, link->send_arbitration_id);
+    if (link->receive_paused && 0 == link->params->wft_max) 
+    {
+        /* no FC.WAIT allowed, the sender can not be held so the message is given up */
+        isotp_debug(link, "Receive paused but no FC.WAIT frame allowed\n");
+        *protocol_result = ISOTP_PROTOCOL_RESULT_WFT_OVRN;
+        link->receive_wait_count = 0;
+        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+        ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+        isotp_indication(link, ISOTP_PROTOCOL_RESULT_WFT_OVRN);
 
-                    /* init multi-frame control flags */
-                    if (ISOTP_RET_OK == ret) 
-                    {
-                        const uint32_t time_us = isotp_user_get_us();
-                        link->send_bs_remain = 0;
-                        link->send_st_min_us = 0;
-                        link->send_wtf_count = 0;
-                        link->send_timer_st = time_us;
-                        link->send_timer_bs = time_us + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
-                        link->send_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-                        link->send_status = ISOTP_SEND_STATUS_INPROGRESS;
-                    }
-                }
-            }
-        }
+    } else if (link->receive_paused) 
+    {
+        link->receive_wait_count = 1;
+        ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_WAIT, 0, 0);
+        link->receive_timer_cr = isotp_clock_us(link, clock) + ISO_TP_RECEIVE_WAIT_US;
+
+    } else {
+
+        link->receive_wait_count = 0;
+        ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, link->params->st_min_us);
+        link->receive_timer_cr = isotp_clock_us(link, clock) + link->params->n_cr_us;
     }
 
     return ret;
 }
 
-int isotp_on_can_message(IsoTpLink *link, const uint8_t *data, uint8_t len) 
+static int isotp_send_start(IsoTpLink *link, uint32_t id, const uint8_t *payload, uint32_t size) 
 {
     assert( link != NULL );
-    assert( data != NULL );
 
-    IsoTpCanMessage message;
     int ret = ISOTP_RET_ERROR;
-    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;   
-    
-    if (len < 2 || len > 8) 
+
+    if (0 == size) 
     {
-       ret = ISOTP_RET_LENGTH;
-       isotp_debug("Len for the msg frame not correct\n");
+        /* an SF_DL of 0 is invalid, the receiver would ignore the frame */
+        isotp_debug(link, "Empty message, nothing to send.\n");
+        ret = ISOTP_RET_LENGTH;
 
     } else {
 
-        memcpy(message.as.data_array.ptr, data, len);
-        memset(message.as.data_array.ptr + len, 0, sizeof(message.as.data_array.ptr) - len);
+        link->send_size = size;
+        link->send_offset = 0;
+        link->send_arbitration_id = id;
+        link->send_payload = payload;
 
-        switch (message.as.common.type) 
+        if (link->send_size <= isotp_sf_max(link->send_tx_dl)) 
         {
-            case ISOTP_PCI_TYPE_SINGLE: 
+            /* send single frame */
+            ret = isotp_send_single_frame(link, link->send_arbitration_id);
+            if (ISOTP_RET_OK == ret) 
             {
-                /* update protocol result */
-                if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
-                {
-                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
-                    isotp_debug("Protocol unexpect first frame\n");
-
-                    break;
-                }
-
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-                
-                /* handle message */
-                ret = isotp_receive_single_frame(link, &message, len);
-                
-                if (ISOTP_RET_OK == ret) 
-                {
-                    /* change status */
-                    link->receive_status = ISOTP_RECEIVE_STATUS_FULL;
-                    /*TODO: Callback for receive function*/
-                }
-
-                break;
+                isotp_send_finish(link, ISOTP_SEND_STATUS_IDLE, ISOTP_PROTOCOL_RESULT_OK);
             }
+        } else {
+            /* send multi-frame */
+            ret = isotp_send_first_frame(link, link->send_arbitration_id);
 
-            case ISOTP_PCI_TYPE_FIRST_FRAME: 
+            /* init multi-frame control flags */
+            if (ISOTP_RET_OK == ret) 
             {
-                /* update protocol result */
-                if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
-                {
-                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
-                    isotp_debug("Protocol unexpect first frame\n");
+                const uint32_t time_us = isotp_link_get_us(link);
+                link->send_bs_remain = 0;
+                link->send_st_min_us = 0;
+                link->send_wtf_count = 0;
+                link->send_timer_st = time_us;
+                link->send_timer_bs = time_us + link->params->n_bs_us;
+                link->send_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+                link->send_status = ISOTP_SEND_STATUS_INPROGRESS;
+            }
+        }
 
-                    break;
-                } 
+        isotp_timer_sync(link);
+    }
 
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-                
-                /* handle message */
-                ret = isotp_receive_first_frame(link, &message, len);
+    return ret;
+}
 
-                /* if overflow happened */
-                if (ISOTP_RET_OVERFLOW == ret) 
-                {
-                    /* update protocol result */
-                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
-                    /* change status */
-                    link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
-                    /* send error message */
-                    ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
-                    
-                    /* if receive successful */
-                } else if (ISOTP_RET_OK == ret) {
-
-                    /* change status */
-                    link->receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
-                    /* send fc frame */
-                    link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                    ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_MS);
-                    /* refresh timer cs */
-                    link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+/* start queued messages while the link is free; a failed start is confirmed and skipped */
+static void isotp_send_next(IsoTpLink *link) 
+{
+    while (link->tx_queue_count > 0 && ISOTP_SEND_STATUS_INPROGRESS != link->send_status) 
+    {
+        const IsoTpTxRequest *request = &link->tx_queue[link->tx_queue_head];
 
-                } else {
+        link->tx_queue_head = (link->tx_queue_head + 1) & link->tx_queue_mask;
+        link->tx_queue_count -= 1;
 
-                    /* empty */
-                }
-                
-                break;
-            }
+        link->send_producer = NULL;
+        link->send_iov = NULL;
+        link->send_completion = request->completion;
+        if (ISOTP_RET_OK != isotp_send_start(link, request->arbitration_id, request->payload, request->size)) 
+        {
+            isotp_send_finish(link, ISOTP_SEND_STATUS_ERROR, ISOTP_PROTOCOL_RESULT_ERROR);
+        }
+    }
+}
 
-            case TSOTP_PCI_TYPE_CONSECUTIVE_FRAME: 
+/* PCI of a frame as isotp_classify_frames decodes it */
+static void isotp_decode_pci(const uint8_t *data, uint8_t len, uint8_t *type, uint8_t *sn, uint32_t *length) 
+{
+    *type = isotp_codec_type(data);
+    *sn = 0;
+    *length = 0;
+
+    switch (*type) 
+    {
+        case ISOTP_PCI_TYPE_SINGLE:
+            *length = isotp_codec_nibble(data);
+            /* frames longer than 8 bytes must use the escape, SF_DL in the nibble is invalid */
+            if (len > 8) 
+            {
+                *length = (0 == *length) ? data[ISOTP_CODEC_SF_ESC_DL] : 0;
+            }
+            break;
+        case ISOTP_PCI_TYPE_FIRST_FRAME:
+            *length = isotp_codec_ff_dl(data);
+            if (0 == *length && len >= 6) 
             {
-                /* check if in receiving status */
-                if (ISOTP_RECEIVE_STATUS_INPROGRESS != link->receive_status) 
+                *length = isotp_codec_get_be32(&data[ISOTP_CODEC_FF_ESC_DL]);
+                /* a length fitting 12 bit must not be escaped */
+                if (*length <= ISOTP_MAX_FF_DL) 
                 {
-                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
-                    isotp_debug("Protocol unexpect consecutive frame\n");
+                    *length = 0;
+                }
+            }
+            break;
+        case TSOTP_PCI_TYPE_CONSECUTIVE_FRAME:
+            *sn = isotp_codec_nibble(data);
+            break;
+        case ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME:
+            *sn = isotp_codec_nibble(data);
+            *length = data[ISOTP_CODEC_FC_BS];
+            break;
+        default:
+            *type = ISOTP_FRAME_TYPE_INVALID;
+            break;
+    }
+}
 
-                    break;
-                } 
+/* handle a frame of valid length by its decoded PCI: type, SN or FS, and SF_DL, FF_DL or BS;
+ * the N_Result of the frame goes to protocol_result, the caller stores it in the link */
+static int isotp_receive_frame(IsoTpLink *link, const uint8_t *data, uint8_t len,
+                               uint8_t type, uint8_t sn, uint32_t length, IsoTpClock *clock, int *protocol_result) 
+{
+    int ret = ISOTP_RET_ERROR;
+    *protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
 
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-                
-                /* handle message */
-                ret = isotp_receive_consecutive_frame(link, &message, len);
+    /* frame handlers take the decoded PCI and never read beyond len */
+    switch (type) 
+    {
+        case ISOTP_PCI_TYPE_SINGLE: 
+        {
+            /* update protocol result */
+            if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
+            {
+                *protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+                isotp_debug(link, "Protocol unexpect first frame\n");
+
+                break;
+            }
+
+            /* leased buffer must not be overwritten */
+            if (ISOTP_RECEIVE_STATUS_LEASED == link->receive_status) 
+            {
+                *protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
+                ret = ISOTP_RET_OVERFLOW;
+                isotp_debug(link, "Receive buffer is leased, single frame dropped\n");
+
+                break;
+            }
+
+            *protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+            
+            /* handle message */
+            ret = isotp_receive_single_frame(link, data, len, length);
+            
+            if (ISOTP_RET_OK == ret) 
+            {
+                /* change status */
+                link->receive_status = ISOTP_RECEIVE_STATUS_FULL;
+                isotp_indication(link, ISOTP_PROTOCOL_RESULT_OK);
+            }
+
+            break;
+        }
 
-                /* if wrong sn */
-                if (ISOTP_RET_WRONG_SN == ret) 
+        case ISOTP_PCI_TYPE_FIRST_FRAME: 
+        {
+            /* update protocol result */
+            if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
+            {
+                *protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+                isotp_debug(link, "Protocol unexpect first frame\n");
+
+                break;
+            } 
+
+            *protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+            
+            /* handle message, a leased buffer can not take a new message */
+            if (ISOTP_RECEIVE_STATUS_LEASED == link->receive_status) 
+            {
+                ret = ISOTP_RET_OVERFLOW;
+                isotp_debug(link, "Receive buffer is leased, first frame rejected\n");
+
+            } else {
+
+                ret = isotp_receive_first_frame(link, data, len, length);
+            }
+
+            /* if overflow happened */
+            if (ISOTP_RET_OVERFLOW == ret) 
+            {
+                /* update protocol result */
+                *protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
+                /* change status, keep the lease */
+                if (ISOTP_RECEIVE_STATUS_LEASED != link->receive_status) 
                 {
-                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_WRONG_SN;
                     link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
-                    break;
                 }
+                /* send error message */
+                ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+                
+                /* if receive successful */
+            } else if (ISOTP_RET_OK == ret) {
 
-                /* if success */
-                if (ISOTP_RET_OK == ret) 
-                {
-                    /* refresh timer cs */
-                    link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
-                    
-                    /* receive finished */
-                    if (link->receive_offset >= link->receive_size) 
-                    {
-                        link->receive_status = ISOTP_RECEIVE_STATUS_FULL;
-                        /*TODO: Callback for received msg. */
+                /* change status */
+                link->receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
+                /* send fc frame, refresh timer cs */
+                ret = isotp_receive_next_block(link, clock, protocol_result);
 
-                    } else {
-                        /* send fc when bs reaches limit */
-                        if ( 0 == --link->receive_bs_count ) 
-                        {
-                            link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                            ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_MS);
-                        }
-                    }
+                /* FF.indication, unless the reception was given up already */
+                if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status && link->callbacks != NULL && link->callbacks->on_ff_indication != NULL) 
+                {
+                    link->callbacks->on_ff_indication(link, link->callback_ctx, link->receive_size);
                 }
-                
-                break;
+
+            } else {
+
+                /* empty */
             }
+            
+            break;
+        }
 
-            case ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME:
+        case TSOTP_PCI_TYPE_CONSECUTIVE_FRAME: 
+        {
+            /* check if in receiving status, no frame may come while the sender is held */
+            if (ISOTP_RECEIVE_STATUS_INPROGRESS != link->receive_status || link->receive_wait_count > 0) 
             {
-                /* handle fc frame only when sending in progress  */
-                if (ISOTP_SEND_STATUS_INPROGRESS != link->send_status) 
-                {
-                    isotp_debug("Protocol unexpect flow control frame\n");
+                *protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+                isotp_debug(link, "Protocol unexpect consecutive frame\n");
 
-                    break;
-                }
+                break;
+            } 
 
-                /* handle message */
-                ret = isotp_receive_flow_control_frame(link, &message, len);
+            *protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+            
+            /* handle message */
+            ret = isotp_receive_consecutive_frame(link, data, len, sn);
+
+            /* if wrong sn */
+            if (ISOTP_RET_WRONG_SN == ret) 
+            {
+                *protocol_result = ISOTP_PROTOCOL_RESULT_WRONG_SN;
+                link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+                isotp_indication(link, ISOTP_PROTOCOL_RESULT_WRONG_SN);
+                break;
+            }
+
+            /* if success */
+            if (ISOTP_RET_OK == ret) 
+            {
+                /* refresh timer cs */
+                link->receive_timer_cr = isotp_clock_us(link, clock) + link->params->n_cr_us;
                 
-                if (ISOTP_RET_OK == ret) 
+                /* receive finished, a streamed message has been handed out already */
+                if (link->receive_offset >= link->receive_size) 
                 {
-                    /* refresh bs timer */
-                    link->send_timer_bs = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+                    link->receive_status = isotp_streaming(link) ? ISOTP_RECEIVE_STATUS_IDLE : ISOTP_RECEIVE_STATUS_FULL;
+                    isotp_indication(link, ISOTP_PROTOCOL_RESULT_OK);
 
-                    /* overflow */
-                    if (PCI_FLOW_STATUS_OVERFLOW == message.as.flow_control.FS) 
+                } else {
+                    /* send fc when bs reaches limit, a block size of 0 has none */
+                    if (0 != link->params->block_size && 0 == --link->receive_bs_count) 
                     {
-                        link->send_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
-                        link->send_status = ISOTP_SEND_STATUS_ERROR; /*TODO: Whot else ?*/
-
-                        isotp_debug("Buffer in the host is overflow\n");
+                        ret = isotp_receive_next_block(link, clock, protocol_result);
                     }
+                }
+            }
+            
+            break;
+        }
 
-                    /* wait */
-                    else if (PCI_FLOW_STATUS_WAIT == message.as.flow_control.FS) 
+        case ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME:
+        {
+            /* handle fc frame only when sending in progress  */
+            if (ISOTP_SEND_STATUS_INPROGRESS != link->send_status) 
+            {
+                isotp_debug(link, "Protocol unexpect flow control frame\n");
+
+                break;
+            }
+
+            /* handle message */
+            ret = isotp_receive_flow_control_frame(link, data, len);
+            
+            if (ISOTP_RET_OK == ret) 
+            {
+                /* refresh bs timer */
+                link->send_timer_bs = isotp_clock_us(link, clock) + link->params->n_bs_us;
+
+                /* overflow */
+                if (PCI_FLOW_STATUS_OVERFLOW == sn) 
+                {
+                    isotp_debug(link, "Buffer in the host is overflow\n");
+                    isotp_send_finish(link, ISOTP_SEND_STATUS_ERROR, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW);
+                }
+
+                /* wait */
+                else if (PCI_FLOW_STATUS_WAIT == sn) 
+                {
+                    link->send_wtf_count += 1;
+                    /* wait exceed allowed count */
+                    if (link->send_wtf_count > link->params->wft_max) 
                     {
-                        link->send_wtf_count += 1;
-                        /* wait exceed allowed count */
-                        if (link->send_wtf_count > ISO_TP_MAX_WFT_NUMBER) 
-                        {
-                            link->send_protocol_result = ISOTP_PROTOCOL_RESULT_WFT_OVRN;
-                            link->send_status = ISOTP_SEND_STATUS_ERROR;
-
-                            isotp_debug("The host not rady\n");
-                        }
+                        isotp_debug(link, "The host not rady\n");
+                        isotp_send_finish(link, ISOTP_SEND_STATUS_ERROR, ISOTP_PROTOCOL_RESULT_WFT_OVRN);
                     }
+                }
 
-                    /* permit send */
-                    else if (PCI_FLOW_STATUS_CONTINUE == message.as.flow_control.FS) 
+                /* permit send */
+                else if (PCI_FLOW_STATUS_CONTINUE == sn) 
+                {
+                    if (0 == length) 
                     {
-                        if (0 == message.as.flow_control.BS) 
-                        {
-                            link->send_bs_remain = ISOTP_INVALID_BS;
-
-                        } else {
+                        link->send_bs_remain = ISOTP_INVALID_BS;
 
-                            link->send_bs_remain = message.as.flow_control.BS;
-                        }
+                    } else {
 
-                        const uint32_t message_st_min_us = isotp_st_ms_to_us(message.as.flow_control.STmin);
-                        const uint32_t user_define_st_min_us = isotp_st_ms_to_us( ISO_TP_DEFAULT_ST_MIN_MS );
-                        link->send_st_min_us = message_st_min_us >  user_define_st_min_us ? message_st_min_us : user_define_st_min_us;    
-                        /*TODO: Change ISO_TP_DEFAULT_ST_MIN_MS on the user frandly*/                     
-                        link->send_wtf_count = 0;
+                        link->send_bs_remain = (uint16_t) length;
                     }
-                }
 
-                break;
+                    const uint32_t message_st_min_us = isotp_st_ms_to_us(link, data[ISOTP_CODEC_FC_STMIN]);
+                    const uint32_t user_define_st_min_us = link->params->st_min_us;
+                    link->send_st_min_us = message_st_min_us >  user_define_st_min_us ? message_st_min_us : user_define_st_min_us;    
+                    link->send_wtf_count = 0;
+                }
             }
 
-            default:
-                isotp_debug("This frame not xxx whis ISOTP protocul\n");
-                break;
-        };
+            break;
+        }
+
+        default:
+            isotp_debug(link, "This frame not xxx whis ISOTP protocul\n");
+            break;
+    };
+
+    return ret;
+}
+
+/* check the length of a frame, decode its PCI and handle it */
+static int isotp_receive_can_frame(IsoTpLink *link, const uint8_t *data, uint8_t len, IsoTpClock *clock, int *protocol_result) 
+{
+    int ret = ISOTP_RET_ERROR;
+    *protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
+
+    if (len < 2 || len > ISO_TP_MAX_FRAME_SIZE || isotp_can_dl(len) != len) 
+    {
+       ret = ISOTP_RET_LENGTH;
+       isotp_debug(link, "Len for the msg frame not correct\n");
+
+    } else {
+
+        uint8_t type;
+        uint8_t sn;
+        uint32_t length;
 
+        isotp_decode_pci(data, len, &type, &sn, &length);
+        ret = isotp_receive_frame(link, data, len, type, sn, length, clock, protocol_result);
     }
+
+    return ret;
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+int isotp_send(IsoTpLink *link, const uint8_t payload[], uint32_t size) {
+    return isotp_send_with_id(link, link->send_arbitration_id, payload, size);
+}
+
+int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size) 
+{
+    assert( link != NULL );
     
+    int ret = ISOTP_RET_ERROR;
+
+    if ( link == NULL ) 
+    {
+        isotp_debug(link, "Link is null!\n");
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        if (size > link->send_buf_size) 
+        {
+            isotp_debug(link, "Message size too large. Increase ISO_TP_MAX_MESSAGE_SIZE to set a larger buffer\n");
+            isotp_debug(link, "Attempted to send %lu bytes; max size is %lu!\n", (unsigned long) size, (unsigned long) link->send_buf_size);
+            ret = ISOTP_RET_OVERFLOW;
+
+        } else if (NULL == link->send_buffer) {
+
+            isotp_debug(link, "Link has no send buffer, use isotp_send_nocopy\n");
+            ret = ISOTP_RET_ERROR;
+
+        } else {
+
+            if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
+            {
+                isotp_debug(link, "Abort previous message, transmission in progress.\n");
+                ret = ISOTP_RET_INPROGRESS;
+
+            } else {
+
+                /* copy into local buffer */
+                (void) memcpy((void *)link->send_buffer, payload, size);
+                link->send_producer = NULL;
+                link->send_iov = NULL;
+                ret = isotp_send_start(link, id, link->send_buffer, size);
+            }
+        }
+    }
+
     return ret;
 }
 
-int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size, uint16_t *out_size) 
+int isotp_send_nocopy(IsoTpLink *link, const uint8_t payload[], uint32_t size) {
+    return isotp_send_with_id_nocopy(link, link->send_arbitration_id, payload, size);
+}
+
+int isotp_send_with_id_nocopy(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size) 
+{
+    assert( link != NULL );
+    assert( payload != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
+    {
+
+        isotp_debug(link, "Abort previous message, transmission in progress.\n");
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        /* reference caller memory, released when the send leaves progress state */
+        link->send_producer = NULL;
+        link->send_iov = NULL;
+        ret = isotp_send_start(link, id, payload, size);
+    }
+
+    return ret;
+}
+
+int isotp_set_tx_queue(IsoTpLink *link, IsoTpTxRequest slots[], uint16_t capacity) 
+{
+    assert( link != NULL );
+    assert( slots != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    /* capacity must be a power of two */
+    if (capacity < 2 || 0 != (capacity & (capacity - 1))) 
+    {
+        ret = ISOTP_RET_ERROR;
+
+    } else if (link->tx_queue_count > 0) {
+
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        link->tx_queue = slots;
+        link->tx_queue_mask = capacity - 1;
+        link->tx_queue_head = 0;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_send_queued(IsoTpLink *link, const uint8_t payload[], uint32_t size) {
+    return isotp_send_queued_with_id(link, link->send_arbitration_id, payload, size);
+}
+
+int isotp_send_queued_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size) 
+{
+    IsoTpTxRequest request;
+
+    request.arbitration_id = id;
+    request.payload = payload;
+    request.size = size;
+    request.completion = NULL;
+
+    return isotp_send_request(link, &request);
+}
+
+int isotp_send_request(IsoTpLink *link, const IsoTpTxRequest *request) 
+{
+    assert( link != NULL );
+    assert( request != NULL );
+    assert( request->payload != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (ISOTP_SEND_STATUS_INPROGRESS != link->send_status && 0 == link->tx_queue_count) 
+    {
+        /* link is free, no need to queue */
+        link->send_completion = request->completion;
+        ret = isotp_send_with_id_nocopy(link, request->arbitration_id, request->payload, request->size);
+
+    } else if (0 == request->size) {
+
+        isotp_debug(link, "Empty message, nothing to send.\n");
+        ret = ISOTP_RET_LENGTH;
+
+    } else if (NULL == link->tx_queue || link->tx_queue_count > link->tx_queue_mask) {
+
+        isotp_debug(link, "Transmit queue is full.\n");
+        ret = ISOTP_RET_OVERFLOW;
+
+    } else {
+
+        link->tx_queue[(link->tx_queue_head + link->tx_queue_count) & link->tx_queue_mask] = *request;
+        link->tx_queue_count += 1;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    /* refused, or failed before any confirm */
+    if (ISOTP_RET_OK != ret && request->completion != NULL && 0 == request->completion->done) 
+    {
+        if (link->send_completion == request->completion) 
+        {
+            link->send_completion = NULL;
+        }
+        isotp_complete(request->completion, ret, ISOTP_PROTOCOL_RESULT_ERROR);
+    }
+
+    return ret;
+}
+
+int isotp_sendv(IsoTpLink *link, const IsoTpIoVec iov[], uint16_t count) {
+    return isotp_sendv_with_id(link, link->send_arbitration_id, iov, count);
+}
+
+int isotp_sendv_with_id(IsoTpLink *link, uint32_t id, const IsoTpIoVec iov[], uint16_t count) 
+{
+    assert( link != NULL );
+    assert( iov != NULL || 0 == count );
+
+    int ret = ISOTP_RET_ERROR;
+    uint32_t size = 0;
+
+    for (uint16_t index = 0; index < count; index++) 
+    {
+        size += iov[index].len;
+    }
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
+    {
+        isotp_debug(link, "Abort previous message, transmission in progress.\n");
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        /* frames gather their data from the segments, nothing is copied up front */
+        link->send_producer = NULL;
+        link->send_iov = iov;
+        link->send_iov_count = count;
+        link->send_iov_index = 0;
+        link->send_iov_base = 0;
+        ret = isotp_send_start(link, id, NULL, size);
+    }
+
+    return ret;
+}
+
+int isotp_send_stream(IsoTpLink *link, uint32_t size, IsoTpSendProducer producer, void *ctx) {
+    return isotp_send_stream_with_id(link, link->send_arbitration_id, size, producer, ctx);
+}
+
+int isotp_send_stream_with_id(IsoTpLink *link, uint32_t id, uint32_t size, IsoTpSendProducer producer, void *ctx) 
+{
+    assert( link != NULL );
+    assert( producer != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
+    {
+        isotp_debug(link, "Abort previous message, transmission in progress.\n");
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        /* frames pull their data from the producer as they are built */
+        link->send_producer = producer;
+        link->send_producer_ctx = ctx;
+        link->send_iov = NULL;
+        ret = isotp_send_start(link, id, NULL, size);
+    }
+
+    return ret;
+}
+
+int isotp_send_buffer_released(const IsoTpLink *link) 
+{
+    assert( link != NULL );
+
+    return ISOTP_SEND_STATUS_INPROGRESS != link->send_status;
+}
+
+int isotp_on_can_message(IsoTpLink *link, const uint8_t *data, uint8_t len) 
+{
+    IsoTpClock clock = { 0, 0 };
+
+    return isotp_on_can_message_at(link, data, len, &clock);
+}
+
+int isotp_on_can_messages(IsoTpLink *link, const IsoTpCanFrame frames[], uint16_t count) 
+{
+    assert( link != NULL );
+    assert( frames != NULL );
+
+    int ret = ISOTP_RET_OK;
+    int protocol_result = link->receive_protocol_result;
+    IsoTpClock clock = { 0, 0 };
+
+    for (uint16_t index = 0; index < count; index++) 
+    {
+        const IsoTpCanFrame *frame = &frames[index];
+        int frame_ret = ISOTP_RET_NO_LINK;
+
+        /* frames of other IDs share the FIFO, they are not for this link */
+        if (ISOTP_NO_RX_ID == link->receive_arbitration_id || frame->arbitration_id == link->receive_arbitration_id) 
+        {
+            frame_ret = isotp_receive_can_frame(link, frame->data, frame->len, &clock, &protocol_result);
+        }
+
+        if (ISOTP_RET_OK != frame_ret) 
+        {
+            ret = frame_ret;
+        }
+    }
+
+    /* result of the last frame handled, the timer follows the state the batch left */
+    link->receive_protocol_result = protocol_result;
+    isotp_timer_sync(link);
+
+    return ret;
+}
+
+int isotp_on_can_message_at(IsoTpLink *link, const uint8_t *data, uint8_t len, IsoTpClock *clock) 
+{
+    assert( link != NULL );
+    assert( data != NULL );
+    assert( clock != NULL );
+
+    int protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
+    const int ret = isotp_receive_can_frame(link, data, len, clock, &protocol_result);
+
+    link->receive_protocol_result = protocol_result;
+    isotp_timer_sync(link);
+
+    return ret;
+}
+
+int isotp_on_can_message_classified(IsoTpLink *link, const uint8_t *data, uint8_t len,
+                                    uint8_t type, uint8_t sn, uint32_t length, IsoTpClock *clock) 
+{
+    assert( link != NULL );
+    assert( data != NULL );
+    assert( clock != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+    int protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
+
+    /* the length of the frame was checked when classifying it */
+    if (ISOTP_FRAME_TYPE_INVALID == type) 
+    {
+       ret = ISOTP_RET_LENGTH;
+       isotp_debug(link, "Len for the msg frame not correct\n");
+
+    } else {
+
+        ret = isotp_receive_frame(link, data, len, type, sn, length, clock, &protocol_result);
+    }
+
+    link->receive_protocol_result = protocol_result;
+    isotp_timer_sync(link);
+
+    return ret;
+}
+
+int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint32_t payload_size, uint32_t *out_size) 
 {
     assert( link != NULL );
     assert( payload != NULL );
     assert( out_size != NULL );
 
     int ret = ISOTP_RET_ERROR;
-    uint16_t copylen = 0;
+    uint32_t copylen = 0;
     
     if (ISOTP_RECEIVE_STATUS_FULL != link->receive_status) 
     {
@@ -649,7 +1414,7 @@ int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size
         if (copylen > payload_size) 
         {
             ret = ISOTP_RET_OVERFLOW; /* TODO: Small buffer size on the receiving device */
-            isotp_debug("Frame response too large for receiving buffer.\n");
+            isotp_debug(link, "Frame response too large for receiving buffer.\n");
             
         } else {
 
@@ -669,43 +1434,294 @@ int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size
     return ret;
 }
 
-IsoTpLink* isotp_init_link(uint32_t sendid, uint8_t *sendbuf, uint16_t sendbufsize, uint8_t *recvbuf, uint16_t recvbufsize) 
+int isotp_receive_lease(IsoTpLink *link, const uint8_t **payload, uint32_t *size) 
+{
+    assert( link != NULL );
+    assert( payload != NULL );
+    assert( size != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (ISOTP_RECEIVE_STATUS_FULL != link->receive_status) 
+    {
+        ret = ISOTP_RET_NO_DATA;
+
+    } else {
+
+        *payload = (const uint8_t *)link->receive_buffer;
+        *size = link->receive_size;
+        link->receive_status = ISOTP_RECEIVE_STATUS_LEASED;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_receive_release(IsoTpLink *link) 
+{
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (ISOTP_RECEIVE_STATUS_LEASED != link->receive_status) 
+    {
+        ret = ISOTP_RET_NO_DATA;
+
+    } else {
+
+        link->receive_size = 0;
+        link->receive_offset = 0;
+        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_receive_resume(IsoTpLink *link) 
+{
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_OK;
+
+    link->receive_paused = 0;
+
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status && link->receive_wait_count > 0) 
+    {
+        IsoTpClock clock = { 0, 0 };
+
+        ret = isotp_receive_next_block(link, &clock, &link->receive_protocol_result);
+        isotp_timer_sync(link);
+    }
+
+    return ret;
+}
+
+int isotp_init_link_static(IsoTpLink *link, uint32_t sendid, uint8_t *sendbuf, uint32_t sendbufsize, uint8_t *recvbuf, uint32_t recvbufsize) 
+{
+    assert( link != NULL );
+    assert( recvbuf != NULL );
+
+    (void) memset(link, 0, sizeof(IsoTpLink));
+    link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+    link->send_status = ISOTP_SEND_STATUS_IDLE;
+    link->send_arbitration_id = sendid;
+    link->receive_arbitration_id = ISOTP_NO_RX_ID;
+    link->send_tx_dl = 8;
+    link->receive_rx_dl = 8;
+    link->send_buffer = (void *)sendbuf;
+    link->send_buf_size = sendbufsize;
+    link->receive_buffer = (void *)recvbuf;
+    link->receive_buf_size = recvbufsize;       
+    link->params = &isotp_default_params;
+#if ISO_TP_USER_DEFAULT_OPS
+    link->user_ops = &isotp_user_default_ops;
+#endif
+
+    return ISOTP_RET_OK;
+}
+
+#if !ISO_TP_NO_HEAP
+IsoTpLink* isotp_init_link(uint32_t sendid, uint8_t *sendbuf, uint32_t sendbufsize, uint8_t *recvbuf, uint32_t recvbufsize) 
 {    
             
-    assert(sendbuf != NULL );
     assert(recvbuf != NULL );
 
-    IsoTpLink* link = calloc(1, sizeof(IsoTpLink));
+    /* keep the cache line alignment of the sender and receiver halves */
+#if defined(_MSC_VER)
+    IsoTpLink* link = _aligned_malloc(sizeof(IsoTpLink), ISOTP_LINK_ALIGN);
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    IsoTpLink* link = aligned_alloc(ISOTP_LINK_ALIGN, sizeof(IsoTpLink));
+#else
+    /* align by hand, the block malloc returned is kept just below the link */
+    IsoTpLink* link = NULL;
+    uint8_t* block = malloc(sizeof(IsoTpLink) + ISOTP_LINK_ALIGN - 1 + sizeof(void*));
+    if( block != NULL )
+    {
+        uintptr_t address = (uintptr_t)(block + sizeof(void*));
+        address = (address + ISOTP_LINK_ALIGN - 1) & ~(uintptr_t)(ISOTP_LINK_ALIGN - 1);
+        link = (IsoTpLink*)address;
+        ((void**)link)[-1] = block;
+    }
+#endif
     if( link != NULL )
     {    
-        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
-        link->send_status = ISOTP_SEND_STATUS_IDLE;
-        link->send_arbitration_id = sendid;
-        link->send_buffer = (void *)sendbuf;
-        link->send_buf_size = sendbufsize;
-        link->receive_buffer = (void *)recvbuf;
-        link->receive_buf_size = recvbufsize;       
+        (void) isotp_init_link_static(link, sendid, sendbuf, sendbufsize, recvbuf, recvbufsize);
         
     } else {
 
-        isotp_debug("Initialize the ISOTP library is FAULT\n");
+        isotp_debug(link, "Initialize the ISOTP library is FAULT\n");
     }
     
     return link;
 }
 
+void isotp_free_link(IsoTpLink *link) 
+{
+    if( link != NULL )
+    {
+#if defined(_MSC_VER)
+        _aligned_free(link);
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+        free(link);
+#else
+        free(((void**)link)[-1]);
+#endif
+    }
+}
+#endif
+
+void isotp_set_user_ops(IsoTpLink *link, const IsoTpUserOps *ops, void *ctx) 
+{
+    assert( link != NULL );
+
+#if ISO_TP_USER_DEFAULT_OPS
+    if (NULL == ops) 
+    {
+        ops = &isotp_user_default_ops;
+    }
+#endif
+
+    link->user_ops = ops;
+    link->user_ctx = ctx;
+}
+
+int isotp_set_params(IsoTpLink *link, const IsoTpLinkParams *params) 
+{
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (NULL == params) 
+    {
+        params = &isotp_default_params;
+    }
+
+    if (params->st_min_us > 127000) 
+    {
+        ret = ISOTP_RET_ERROR;
+        isotp_debug(link, "STmin %u us is above 127 ms\n", (unsigned) params->st_min_us);
+
+    } else if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status || ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
+
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        link->params = params;
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_set_tx_dl(IsoTpLink *link, uint8_t tx_dl) 
+{
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (tx_dl < 8 || tx_dl > ISO_TP_MAX_FRAME_SIZE || isotp_can_dl(tx_dl) != tx_dl) 
+    {
+        ret = ISOTP_RET_LENGTH;
+        isotp_debug(link, "TX_DL %d is not a valid CAN data length\n", tx_dl);
+
+    } else if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
+
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else {
+
+        link->send_tx_dl = tx_dl;
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+void isotp_set_rx_id(IsoTpLink *link, uint32_t rx_id) 
+{
+    assert( link != NULL );
+
+    link->receive_arbitration_id = rx_id;
+}
+
+void isotp_set_callbacks(IsoTpLink *link, const IsoTpCallbacks *callbacks, void *ctx) 
+{
+    assert( link != NULL );
+
+    link->callbacks = callbacks;
+    link->callback_ctx = ctx;
+}
+
+int isotp_next_deadline(const IsoTpLink *link, uint32_t *deadline_us) 
+{
+    assert( link != NULL );
+    assert( deadline_us != NULL );
+
+    int ret = ISOTP_RET_NO_DATA;
+    uint32_t deadline = 0;
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
+    {
+        /* N_Bs timeout */
+        deadline = link->send_timer_bs + 1;
+        ret = ISOTP_RET_OK;
+
+        /* next consecutive frame, if the block allows one */
+        if (ISOTP_INVALID_BS == link->send_bs_remain || link->send_bs_remain > 0) 
+        {
+            const uint32_t st_deadline = (0 == link->send_st_min_us) ? link->send_timer_st : link->send_timer_st + 1;
+            if (IsoTpTimeAfter(deadline, st_deadline)) 
+            {
+                deadline = st_deadline;
+            }
+        }
+    }
+
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
+    {
+        /* N_Cr timeout */
+        const uint32_t cr_deadline = link->receive_timer_cr + 1;
+        if (ISOTP_RET_NO_DATA == ret || IsoTpTimeAfter(deadline, cr_deadline)) 
+        {
+            deadline = cr_deadline;
+        }
+        ret = ISOTP_RET_OK;
+    }
+
+    if (ISOTP_RET_OK == ret) 
+    {
+        *deadline_us = deadline;
+    }
+
+    return ret;
+}
+
 void isotp_poll(IsoTpLink *link) 
+{
+    (void) isotp_poll_burst(link, 1);
+
+    return;
+}
+
+uint16_t isotp_poll_burst(IsoTpLink *link, uint16_t max_frames) 
 {
     assert( link != NULL );
    
     int ret = ISOTP_RET_ERROR;
-    const uint32_t time_us = isotp_user_get_us();
+    uint16_t frames = 0;
+    const uint32_t time_us = isotp_link_get_us(link);
 
     /* only polling when operation in progress */
     if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) 
     {
-        /* continue send data */
-        if (/* send data if bs_remain is invalid or bs_remain large than zero */
+        /* continue send data, as many frames as block size, st_min and budget allow */
+        while (frames < max_frames &&
+        ISOTP_SEND_STATUS_INPROGRESS == link->send_status &&
+        /* send data if bs_remain is invalid or bs_remain large than zero */
         (ISOTP_INVALID_BS == link->send_bs_remain || link->send_bs_remain > 0) &&
         /* and if st_min is zero or go beyond interval time */
         (0 == link->send_st_min_us || IsoTpTimeAfter(time_us, link->send_timer_st))) 
@@ -713,39 +1729,70 @@ void isotp_poll(IsoTpLink *link)
             ret = isotp_send_consecutive_frame(link);
             if (ISOTP_RET_OK == ret) 
             {
+                frames += 1;
                 if (ISOTP_INVALID_BS != link->send_bs_remain) {
                     link->send_bs_remain -= 1;
                 }
-                link->send_timer_bs = time_us + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+                link->send_timer_bs = time_us + link->params->n_bs_us;
                 link->send_timer_st = time_us + link->send_st_min_us;
 
                 /* check if send finish */
                 if (link->send_offset >= link->send_size) {
-                    link->send_status = ISOTP_SEND_STATUS_IDLE;
+                    isotp_send_finish(link, ISOTP_SEND_STATUS_IDLE, ISOTP_PROTOCOL_RESULT_OK);
                 }
 
+            } else if (ISOTP_RET_NO_DATA == ret) {
+
+                /* producer not ready, retry on the next poll */
+                break;
+
             } else {
-                link->send_status = ISOTP_SEND_STATUS_ERROR;
+                isotp_send_finish(link, ISOTP_SEND_STATUS_ERROR, ISOTP_PROTOCOL_RESULT_ERROR);
             }
         }
 
         /* check timeout */
-        if (IsoTpTimeAfter(time_us, link->send_timer_bs)) {
-            link->send_protocol_result = ISOTP_PROTOCOL_RESULT_TIMEOUT_BS;
-            link->send_status = ISOTP_SEND_STATUS_IDLE;
+        if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status && IsoTpTimeAfter(time_us, link->send_timer_bs)) {
+            isotp_send_finish(link, ISOTP_SEND_STATUS_IDLE, ISOTP_PROTOCOL_RESULT_TIMEOUT_BS);
         }
     }
 
+    /* keep the bus busy with the next queued message */
+    isotp_send_next(link);
+
     /* only polling when operation in progress */
     if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) 
     {        
+        /* sender held by FC.WAIT, repeat it while allowed */
+        if (link->receive_wait_count > 0) 
+        {
+            if (IsoTpTimeAfter(time_us, link->receive_timer_cr)) 
+            {
+                if (link->receive_wait_count < link->params->wft_max) 
+                {
+                    link->receive_wait_count += 1;
+                    (void) isotp_send_flow_control(link, PCI_FLOW_STATUS_WAIT, 0, 0);
+                    link->receive_timer_cr = time_us + ISO_TP_RECEIVE_WAIT_US;
+
+                } else {
+
+                    isotp_debug(link, "Receive paused longer than the allowed FC.WAIT frames\n");
+                    link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_WFT_OVRN;
+                    link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+                    isotp_indication(link, ISOTP_PROTOCOL_RESULT_WFT_OVRN);
+                }
+            }
+
         /* check timeout */
-        if (IsoTpTimeAfter(time_us, link->receive_timer_cr)) 
+        } else if (IsoTpTimeAfter(time_us, link->receive_timer_cr)) 
         {
             link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_TIMEOUT_CR;
             link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+            isotp_indication(link, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR);
         }
     }
 
-    return;
+    isotp_timer_sync(link);
+
+    return frames;
 }
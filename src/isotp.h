@@ -4,69 +4,335 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#include "isotp_defines.h"
 #include "isotp_config.h"
+#include "isotp_defines.h"
 #include "isotp_user.h"
 
+/* Build without malloc/calloc/free, links then live in caller-provided storage only.
+ */
+#ifndef ISO_TP_NO_HEAP
+#define ISO_TP_NO_HEAP                      ( 0 )
+#endif
+
+/* Interval of the FC.WAIT frames holding a sender while a streaming receive is paused,
+ * must stay below the N_Bs timeout of the sender.
+ */
+#ifndef ISO_TP_RECEIVE_WAIT_US
+#define ISO_TP_RECEIVE_WAIT_US              ( ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US / 2 )
+#endif
+
+/* Value of the bytes padding a frame, to 8 bytes or to the next CAN FD data length.
+ */
+#ifndef ISO_TP_FRAME_PADDING_BYTE
+#define ISO_TP_FRAME_PADDING_BYTE           ( 0x00 )
+#endif
+
+/**
+ * @brief Time of a batch of CAN frames, read from the link clock when the first frame needs it.
+ * Start with both fields zero.
+ */
+typedef struct IsoTpClock {
+    uint32_t                    us;
+    uint8_t                     valid;
+} IsoTpClock;
+
+/**
+ * @brief Timer of a link armed in an @code IsoTpTimerWheel @endcode, see isotp_timer.h.
+ */
+typedef struct IsoTpTimer {
+    struct IsoTpTimer*          next;
+    struct IsoTpTimer**         pprev;            /* NULL while not armed */
+    uint32_t                    deadline_us;
+} IsoTpTimer;
+
+struct IsoTpTimerWheel;
+struct IsoTpLink;
+
+/**
+ * @brief Service primitives of a link, invoked from the protocol path.
+ * Every callback is optional and receives the context given to @link isotp_set_callbacks @endlink.
+ */
+typedef struct IsoTpCallbacks {
+    /* N_USData.indication: reception finished with an ISOTP_PROTOCOL_RESULT_* result.
+     * On success the message stays in the receive buffer until isotp_receive or
+     * isotp_receive_lease, which may be called from the callback. Streamed messages
+     * were already handed to on_receive_chunk, payload is NULL for them. */
+    void (*on_indication)(struct IsoTpLink *link, void *ctx, int result, const uint8_t *payload, uint32_t size);
+    /* N_USData_FF.indication: first frame received, announcing the message length */
+    void (*on_ff_indication)(struct IsoTpLink *link, void *ctx, uint32_t size);
+    /* N_USData.confirm: a send accepted by isotp_send* finished with an ISOTP_PROTOCOL_RESULT_* result.
+     * Payloads passed to isotp_send_nocopy are released at this point. */
+    void (*on_confirm)(struct IsoTpLink *link, void *ctx, int result);
+    /* Streaming receive: when set, multi-frame messages are not limited by the receive buffer,
+     * which only stages their data. Each time it fills up, and at the end of the message, the
+     * staged bytes at @p offset of the message are passed here and may be reused once it returns.
+     * Return ISOTP_RET_OK to go on, or ISOTP_RET_INPROGRESS to hold the sender with FC.WAIT
+     * from the next block on until isotp_receive_resume is called. */
+    int (*on_receive_chunk)(struct IsoTpLink *link, void *ctx, const uint8_t *data, uint32_t offset, uint32_t size);
+} IsoTpCallbacks;
+
+/**
+ * @brief Protocol parameters of a link, see @link isotp_set_params @endlink.
+ */
+typedef struct IsoTpLinkParams {
+    uint8_t                     block_size;       /* BS of the flow control sent, 0 lets the sender send all frames at once */
+    uint8_t                     wft_max;          /* FC.WAIT frames allowed in a row, sent or received */
+    uint8_t                     padding;          /* pad frames shorter than 8 bytes to 8 */
+    uint8_t                     padding_byte;     /* value of the padding, also of the bytes filling up a CAN FD frame */
+    uint32_t                    st_min_us;        /* STmin of the flow control sent, also the least gap kept when sending;
+                                                     up to 127000, below 1000 in steps of 100 */
+    uint32_t                    n_bs_us;          /* N_Bs, longest wait for a flow control when sending */
+    uint32_t                    n_cr_us;          /* N_Cr, longest wait for a consecutive frame when receiving */
+} IsoTpLinkParams;
+
+/* Parameters of links without own ones, from isotp_config.h */
+#define ISOTP_LINK_PARAMS_DEFAULT { ISO_TP_DEFAULT_BLOCK_SIZE, ISO_TP_MAX_WFT_NUMBER, ISO_TP_FRAME_PADDING, ISO_TP_FRAME_PADDING_BYTE, \
+                                    ( ISO_TP_DEFAULT_ST_MIN_MS ) * 1000, ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US, \
+                                    ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US }
+
+/**
+ * @brief One segment of a message sent with @link isotp_sendv @endlink.
+ */
+typedef struct IsoTpIoVec {
+    const void*                 base;
+    uint32_t                    len;
+} IsoTpIoVec;
+
+/**
+ * @brief Outcome of a send, for a thread waiting on it instead of using on_confirm.
+ * Read done with ISOTP_LOAD_ACQUIRE; once it is non zero, status and result are valid.
+ */
+typedef struct IsoTpCompletion {
+    uint32_t                    done;
+    int                         status;           /* ISOTP_RET_OK, or why the send was refused */
+    int                         result;           /* ISOTP_PROTOCOL_RESULT_* of N_USData.confirm */
+} IsoTpCompletion;
+
+/**
+ * @brief A message waiting in the transmit queue of a link, see @link isotp_set_tx_queue @endlink.
+ */
+typedef struct IsoTpTxRequest {
+    uint32_t                    arbitration_id;
+    const uint8_t*              payload;
+    uint32_t                    size;
+    IsoTpCompletion*            completion;       /* signalled at the end of the send, may be NULL */
+} IsoTpTxRequest;
+
+/**
+ * @brief Supplies the data of a streamed send, see @link isotp_send_stream @endlink.
+ *
+ * Copies @p size bytes at @p offset of the message to @p data. Returns ISOTP_RET_OK,
+ * ISOTP_RET_NO_DATA if the bytes are not available yet, the frame is then retried by
+ * the next isotp_poll, or any other value to abort the send.
+ */
+typedef int (*IsoTpSendProducer)(struct IsoTpLink *link, void *ctx, uint8_t *data, uint32_t offset, uint32_t size);
+
 /**
  * @brief Struct containing the data for linking an application to a CAN instance.
  * The data stored in this struct is used internally and may be used by software programs
  * using this library.
+ *
+ * Fields are grouped by who writes them: the sender and the receiver each start on their own
+ * cache line with the fields touched for every frame first, then what only changes per message,
+ * including the IDs, queue and buffer of that direction. The timer is re-armed by both
+ * directions on every frame and gets a line of its own, the line after it holds the user ops,
+ * parameters and callbacks, which are read on every frame but only written when the link is set up.
+ * Sizes are checked against ISO_TP_LINK_SIZE_BUDGET when the library is built.
  */
 typedef struct IsoTpLink {
-    /* sender paramters */
-    uint32_t                    send_arbitration_id; /* used to reply consecutive frame */
-    /* message buffer */
-    const void*                 send_buffer;
-    uint16_t                    send_buf_size;
-    uint16_t                    send_size;
-    uint16_t                    send_offset;
-    /* multi-frame flags */
+    /* sender, per frame */
+    ISOTP_ALIGNED(ISOTP_CACHE_LINE_SIZE)
+    uint8_t                     send_status;
     uint8_t                     send_sn;
+    uint8_t                     send_tx_dl;     /* CAN data length of sent frames, 8 or a CAN FD length */
+    uint8_t                     send_wtf_count; /* Maximum number of FC.Wait frame transmissions  */
     uint16_t                    send_bs_remain; /* Remaining block size */
+    uint16_t                    send_iov_index; /* segment holding send_iov_base */
     uint32_t                    send_st_min_us; /* Separation Time between consecutive frames */
-    uint8_t                     send_wtf_count; /* Maximum number of FC.Wait frame transmissions  */
     uint32_t                    send_timer_st;  /* Last time send consecutive frame */    
     uint32_t                    send_timer_bs;  /* Time until reception of the next FlowControl N_PDU
                                                    start at sending FF, CF, receive FC
                                                    end at receive FC */
+    uint32_t                    send_size;
+    uint32_t                    send_offset;
+    uint32_t                    send_arbitration_id; /* used to reply consecutive frame */
+    const uint8_t*              send_payload;   /* data being transmitted, either send_buffer or caller memory */
+    IsoTpSendProducer           send_producer;  /* pulls the data instead, if set */
+    const IsoTpIoVec*           send_iov;       /* or gathers it from caller segments, if set */
+    uint32_t                    send_iov_base;  /* message offset of that segment */
+    uint16_t                    send_iov_count;
+    /* sender, per message */
     int                         send_protocol_result;
-    uint8_t                     send_status;
-    /* receiver paramters */
-    uint32_t                    receive_arbitration_id;
+    void*                       send_producer_ctx;
+    IsoTpCompletion*            send_completion; /* of the message being sent, if any */
+    /* transmit queue */
+    IsoTpTxRequest*             tx_queue;       /* ring of messages sent after the current one */
+    uint16_t                    tx_queue_mask;  /* capacity - 1 */
+    uint16_t                    tx_queue_head;
+    uint16_t                    tx_queue_count;
     /* message buffer */
-    const void*                 receive_buffer;
-    uint16_t                    receive_buf_size;
-    uint16_t                    receive_size;
-    uint16_t                    receive_offset;
-    /* multi-frame control */
+    uint32_t                    send_buf_size;
+    const void*                 send_buffer;
+
+    /* receiver, per frame */
+    ISOTP_ALIGNED(ISOTP_CACHE_LINE_SIZE)
+    uint8_t                     receive_status;
     uint8_t                     receive_sn;
+    uint8_t                     receive_rx_dl;    /* CAN data length of the sender, taken from the first frame */
     uint8_t                     receive_bs_count; /* Maximum number of FC.Wait frame transmissions  */
+    uint8_t                     receive_paused;   /* streaming sink asked to hold the sender */
+    uint8_t                     receive_wait_count; /* FC.WAIT sent in a row, CTS outstanding while non zero */
+    uint32_t                    receive_size;
+    uint32_t                    receive_offset;
     uint32_t                    receive_timer_cr; /* Time until transmission of the next ConsecutiveFrame N_PDU
                                                      start at sending FC, receive CF 
                                                      end at receive FC */
+    uint32_t                    receive_stream_offset; /* message offset of the staged chunk */
+    /* message buffer */
+    const void*                 receive_buffer;
+    uint32_t                    receive_buf_size;
+    /* receiver, per message */
     int                         receive_protocol_result;
-    uint8_t                     receive_status;                                                     
+    uint32_t                    receive_arbitration_id;
+
+    /* scheduling, written by both directions */
+    ISOTP_ALIGNED(ISOTP_CACHE_LINE_SIZE)
+    IsoTpTimer                  timer;
+    struct IsoTpTimerWheel*     timer_wheel;      /* armed with the next deadline, if set */
+
+    /* shared configuration, read by both directions */
+    ISOTP_ALIGNED(ISOTP_CACHE_LINE_SIZE)
+    const IsoTpUserOps*         user_ops;
+    void*                       user_ctx;         /* passed to every user_ops callback */
+    const IsoTpLinkParams*      params;
+    /* service primitives */
+    const IsoTpCallbacks*       callbacks;
+    void*                       callback_ctx;
 } IsoTpLink;
 
+/* Size a link may take, five 64 byte cache lines or five cache lines if those are larger.
+ */
+#ifndef ISO_TP_LINK_SIZE_BUDGET
+#define ISO_TP_LINK_SIZE_BUDGET             ( 5 * ( ISOTP_CACHE_LINE_SIZE > 64 ? ISOTP_CACHE_LINE_SIZE : 64 ) )
+#endif
+
+/* Storage requirements of a link, for arenas and memory pools */
+#define ISOTP_LINK_SIZE         sizeof(IsoTpLink)
+#if defined(__cplusplus)
+#define ISOTP_LINK_ALIGN        alignof(IsoTpLink)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ISOTP_LINK_ALIGN        _Alignof(IsoTpLink)
+#else
+#define ISOTP_LINK_ALIGN        offsetof(struct { char c; IsoTpLink link; }, link)
+#endif
+
+/**
+ * @brief Initialises a link in caller-provided storage, no memory is allocated.
+ *
+ * @param link Storage for the link, at least @code ISOTP_LINK_SIZE @endcode bytes aligned to @code ISOTP_LINK_ALIGN @endcode.
+ * @param sendid The ID used to send data to other CAN nodes.
+ * @param sendbuf A pointer to an area in memory which can be used as a buffer for data to be sent.
+ *                May be NULL when the link only sends with @link isotp_send_nocopy @endlink.
+ * @param sendbufsize The size of the buffer area.
+ * @param recvbuf A pointer to an area in memory which can be used as a buffer for data to be received.
+ * @param recvbufsize The size of the buffer area.
+ * @return ISOTP_RET_OK
+ */
+int isotp_init_link_static(IsoTpLink *link, uint32_t sendid,
+                     uint8_t *sendbuf, uint32_t sendbufsize,
+                     uint8_t *recvbuf, uint32_t recvbufsize);
+
+#if !ISO_TP_NO_HEAP
 /**
  * @brief Initialises the ISO-TP library.
  * 
  * @param sendid The ID used to send data to other CAN nodes.
  * @param sendbuf A pointer to an area in memory which can be used as a buffer for data to be sent.
+ *                May be NULL when the link only sends with @link isotp_send_nocopy @endlink.
  * @param sendbufsize The size of the buffer area.
  * @param recvbuf A pointer to an area in memory which can be used as a buffer for data to be received.
  * @param recvbufsize The size of the buffer area.
- * @return The @code IsoTpLink @endcode instance used for transceiving data.
+ * @return The @code IsoTpLink @endcode instance used for transceiving data, or NULL when out of memory.
+ *         The link is aligned to @code ISOTP_LINK_ALIGN @endcode and must be released with
+ *         @link isotp_free_link @endlink, not with free().
  */
 IsoTpLink* isotp_init_link(uint32_t sendid, 
-                     uint8_t *sendbuf, uint16_t sendbufsize,
-                     uint8_t *recvbuf, uint16_t recvbufsize);
+                     uint8_t *sendbuf, uint32_t sendbufsize,
+                     uint8_t *recvbuf, uint32_t recvbufsize);
+
+/**
+ * @brief Releases a link returned by @link isotp_init_link @endlink. The buffers passed to it
+ * are not touched. NULL is ignored.
+ *
+ * @param link The @code IsoTpLink @endcode instance to release.
+ */
+void isotp_free_link(IsoTpLink *link);
+#endif
+
+/**
+ * @brief Sets the transport used by a link, instead of the global isotp_user_* functions.
+ *
+ * Links which use different ops and contexts are independent, so several CAN buses may be
+ * driven from one process, each from its own thread.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param ops The transport callbacks; must stay valid while the link is used.
+ *            NULL restores the isotp_user_* functions.
+ * @param ctx User context passed to every callback of @p ops.
+ */
+void isotp_set_user_ops(IsoTpLink *link, const IsoTpUserOps *ops, void *ctx);
+
+/**
+ * @brief Sets the CAN data length a link sends with (TX_DL), 8 for classic CAN by default.
+ *
+ * A TX_DL above 8 switches the sender to CAN FD frames: single frames of up to TX_DL - 2 bytes,
+ * first and consecutive frames filled to TX_DL. The receiver follows the length of each
+ * incoming first frame, whatever the TX_DL is.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param tx_dl 8, 12, 16, 20, 24, 32, 48 or 64, at most ISO_TP_MAX_FRAME_SIZE.
+ *
+ * @return
+ *  - @link ISOTP_RET_OK @endlink
+ *  - @link ISOTP_RET_LENGTH @endlink if tx_dl is not a valid CAN data length
+ *  - @link ISOTP_RET_INPROGRESS @endlink if a message is being sent
+ */
+int isotp_set_tx_dl(IsoTpLink *link, uint8_t tx_dl);
+
+/**
+ * @brief Sets the CAN ID a link receives on, ISOTP_NO_RX_ID after init.
+ *
+ * Only @link isotp_on_can_messages @endlink looks at the ID, to skip frames of other IDs in a batch;
+ * @link isotp_dispatcher_register @endlink sets it as well.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param rx_id The CAN ID of the frames for the link, or ISOTP_NO_RX_ID to take frames of any ID.
+ */
+void isotp_set_rx_id(IsoTpLink *link, uint32_t rx_id);
+
+/**
+ * @brief Sets the protocol parameters of a link: block size, STmin, N_Bs and N_Cr timeouts,
+ * FC.WAIT limit and padding, instead of the isotp_config.h defaults.
+ *
+ * Links talking to fast peers may run with BS 0 and STmin 0 while others keep a conservative
+ * timing. One parameter block may be shared by many links; it is read while messages are
+ * transferred and may only be modified, or replaced, between messages.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param params The parameters; must stay valid while the link is used. NULL restores the defaults.
+ *
+ * @return
+ *  - @link ISOTP_RET_OK @endlink
+ *  - @link ISOTP_RET_ERROR @endlink if st_min_us can not be sent in a flow control
+ *  - @link ISOTP_RET_INPROGRESS @endlink if a message is being sent or received
+ */
+int isotp_set_params(IsoTpLink *link, const IsoTpLinkParams *params);
 
 /**
  * @brief Polling function; call this function periodically to handle timeouts, send consecutive frames, etc.
@@ -75,6 +341,43 @@ IsoTpLink* isotp_init_link(uint32_t sendid,
  */
 void isotp_poll(IsoTpLink *link);
 
+/**
+ * @brief Registers indication and confirm callbacks, so the application is notified
+ * instead of scanning receive_status and send_status.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param callbacks The callbacks; must stay valid while the link is used. NULL removes them.
+ * @param ctx User context passed to every callback.
+ */
+void isotp_set_callbacks(IsoTpLink *link, const IsoTpCallbacks *callbacks, void *ctx);
+
+/**
+ * @brief Returns the time at which the link next needs @link isotp_poll @endlink, so an
+ * event loop can sleep until then instead of polling continuously.
+ *
+ * The deadline covers the next consecutive frame due after STmin and the N_Bs and N_Cr timeouts.
+ * It is in the time base of the link clock and may already have passed; compare it with
+ * @code IsoTpTimeAfter @endcode, e.g. sleep for (int32_t)(deadline - now) microseconds when positive.
+ * Received frames and new sends may move the deadline, query again after handling them.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param deadline_us A reference to a variable which will contain the deadline.
+ * @return ISOTP_RET_OK, or ISOTP_RET_NO_DATA if the link has no pending timer.
+ */
+int isotp_next_deadline(const IsoTpLink *link, uint32_t *deadline_us);
+
+/**
+ * @brief Same as @link isotp_poll @endlink, but sends up to @p max_frames consecutive frames in one call.
+ *
+ * Frames are handed to the driver back to back while the block size announced by the receiver
+ * and STmin allow it, so with BS=0 and STmin=0 a whole message may go out in a single call.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param max_frames The TX budget, i.e. the maximum number of consecutive frames to send.
+ * @return The number of consecutive frames sent.
+ */
+uint16_t isotp_poll_burst(IsoTpLink *link, uint16_t max_frames);
+
 /**
  * @brief Handles incoming CAN messages.
  * Determines whether an incoming message is a valid ISO-TP frame or not and handles it accordingly.
@@ -86,6 +389,27 @@ void isotp_poll(IsoTpLink *link);
  */
 int isotp_on_can_message(IsoTpLink *link, const uint8_t *data, uint8_t len);
 
+/**
+ * @brief Handles a batch of incoming CAN messages, e.g. as drained from a driver FIFO or recvmmsg.
+ * The clock is read at most once and the timer of the link is updated once, for the whole batch;
+ * receive_protocol_result is left at the result of the last frame handled.
+ * Frames whose arbitration_id is not the receive ID of the link, see @link isotp_set_rx_id @endlink,
+ * are skipped; while the link has no receive ID every frame is taken.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param frames The frames received via CAN, in order of reception.
+ * @param count The number of frames.
+ * @return ISOTP_RET_OK if every frame was handled, otherwise the error of the last frame which failed,
+ *         ISOTP_RET_NO_LINK for a frame of another ID.
+ */
+int isotp_on_can_messages(IsoTpLink *link, const IsoTpCanFrame frames[], uint16_t count);
+
+/**
+ * @brief See @link isotp_on_can_message @endlink, taking the time from a clock shared by a batch of frames.
+ * Used by batching layers, links sharing a clock must share a time base.
+ */
+int isotp_on_can_message_at(IsoTpLink *link, const uint8_t *data, uint8_t len, IsoTpClock *clock);
+
 /**
  * @brief Sends ISO-TP frames via CAN, using the ID set in the initialising function.
  *
@@ -93,34 +417,206 @@ int isotp_on_can_message(IsoTpLink *link, const uint8_t *data, uint8_t len);
  * Multi-frame messages will be sent consecutively when calling isotp_poll.
  *
  * @param link The @code IsoTpLink @endcode instance used for transceiving data.
- * @param payload The payload to be sent. (Up to 4095 bytes).
+ * @param payload The payload to be sent, up to the size of the send buffer (FF_DL above 4095 uses the 32 bit escape).
  * @param size The size of the payload to be sent.
  *
  * @return Possible return values:
  *  - @code ISOTP_RET_OVERFLOW @endcode
+ *  - @code ISOTP_RET_LENGTH @endcode if @p size is 0
  *  - @code ISOTP_RET_INPROGRESS @endcode
  *  - @code ISOTP_RET_OK @endcode
  *  - The return value of the user shim function isotp_user_send_can().
  */
-int isotp_send(IsoTpLink *link, const uint8_t payload[], uint16_t size);
+int isotp_send(IsoTpLink *link, const uint8_t payload[], uint32_t size);
 
 /**
  * @brief See @link isotp_send @endlink, with the exception that this function is used only for functional addressing.
  */
-int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size);
+int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief Sends ISO-TP frames directly from the caller's memory, without copying the payload into the send buffer.
+ *
+ * The library keeps a reference to @p payload and reads consecutive frames from it in isotp_poll.
+ * The caller owns the memory and must neither modify nor release it until
+ * @link isotp_send_buffer_released @endlink returns non-zero for this link.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param payload The payload to be sent.
+ * @param size The size of the payload to be sent.
+ *
+ * @return Same as @link isotp_send @endlink.
+ */
+int isotp_send_nocopy(IsoTpLink *link, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief See @link isotp_send_nocopy @endlink, with the exception that this function is used only for functional addressing.
+ */
+int isotp_send_with_id_nocopy(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief Gives a link a transmit queue, so messages may be submitted while another one is sent.
+ *
+ * @param link The @code IsoTpLink @endlink instance used.
+ * @param slots Storage for the queued requests; must stay valid while the link is used.
+ * @param capacity The number of slots; must be a power of two.
+ * @return ISOTP_RET_OK, ISOTP_RET_ERROR if the capacity is invalid, or
+ *         ISOTP_RET_INPROGRESS if messages are still queued.
+ */
+int isotp_set_tx_queue(IsoTpLink *link, IsoTpTxRequest slots[], uint16_t capacity);
+
+/**
+ * @brief Sends a message as soon as the link is free, without copying it.
+ *
+ * The message starts right away if nothing is being sent, otherwise it waits in the transmit queue
+ * and is started by the isotp_poll which finishes the message before it. Like with
+ * @link isotp_send_nocopy @endlink the payload must stay untouched until it is sent: its
+ * on_confirm callback has fired, when link->send_payload is the payload, or
+ * @link isotp_send_buffer_released @endlink returns non-zero.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param payload The payload to be sent.
+ * @param size The size of the payload to be sent.
+ *
+ * @return Same as @link isotp_send @endlink, but ISOTP_RET_OVERFLOW when the queue is full
+ *         instead of ISOTP_RET_INPROGRESS.
+ */
+int isotp_send_queued(IsoTpLink *link, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief See @link isotp_send_queued @endlink, with the exception that this function is used only for functional addressing.
+ */
+int isotp_send_queued_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief See @link isotp_send_queued_with_id @endlink, and signals @p request->completion when
+ * the message is done.
+ *
+ * The completion is signalled exactly once: with the result of N_USData.confirm, or right away
+ * with status set to the error code if the message is refused. Its done flag must be 0 before
+ * the call and is not reset here, a thread waiting on it may already read it; isotp_submit clears it.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param request The message; copied, only the payload and the completion must stay valid.
+ *
+ * @return Same as @link isotp_send_queued @endlink.
+ */
+int isotp_send_request(IsoTpLink *link, const IsoTpTxRequest *request);
 
 /**
- * @brief Receives and parses the received data and copies the parsed data in to the internal buffer.
+ * @brief Sends a message made of several segments, e.g. a header and a body, without
+ * concatenating them first.
+ *
+ * Frames are filled straight from the segments, no data is copied into the send buffer.
+ * Like with @link isotp_send_nocopy @endlink, @p iov and the segment memory must stay
+ * untouched until @link isotp_send_buffer_released @endlink returns non-zero.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param iov The segments, in message order. Empty segments are allowed.
+ * @param count The number of segments.
+ *
+ * @return Same as @link isotp_send @endlink.
+ */
+int isotp_sendv(IsoTpLink *link, const IsoTpIoVec iov[], uint16_t count);
+
+/**
+ * @brief See @link isotp_sendv @endlink, with the exception that this function is used only for functional addressing.
+ */
+int isotp_sendv_with_id(IsoTpLink *link, uint32_t id, const IsoTpIoVec iov[], uint16_t count);
+
+/**
+ * @brief Sends a message whose data is pulled from @p producer frame by frame, instead of
+ * being held in memory.
+ *
+ * The first frame goes out right away with the first bytes of the message; each consecutive frame
+ * asks for its bytes when isotp_poll builds it, so the payload may still be produced while the
+ * transfer runs. A producer answering ISOTP_RET_NO_DATA delays the frame, not longer than the
+ * N_Cr timeout of the receiver.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param size The total size of the message.
+ * @param producer Supplies the data, called from isotp_send_stream and isotp_poll.
+ * @param ctx User context passed to @p producer.
+ *
+ * @return Same as @link isotp_send @endlink, or the return value of @p producer if it
+ *         could not supply the first frame.
+ */
+int isotp_send_stream(IsoTpLink *link, uint32_t size, IsoTpSendProducer producer, void *ctx);
+
+/**
+ * @brief See @link isotp_send_stream @endlink, with the exception that this function is used only for functional addressing.
+ */
+int isotp_send_stream_with_id(IsoTpLink *link, uint32_t id, uint32_t size, IsoTpSendProducer producer, void *ctx);
+
+/**
+ * @brief Checks whether the library still references the payload of the last send.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @return Non-zero when the payload passed to @link isotp_send_nocopy @endlink may be reused by the caller.
+ */
+int isotp_send_buffer_released(const IsoTpLink *link);
+
+/**
+ * @brief Copies the received message out of the receive buffer and frees the buffer for the next one.
+ *
+ * Messages up to the size of the receive buffer are received, 4 GiB at most with the 32 bit FF_DL escape.
+ * A message larger than @p payload_size is dropped with ISOTP_RET_OVERFLOW; use @link isotp_receive_lease @endlink
+ * to read large messages in place instead of copying them.
+ *
  * @param link The @link IsoTpLink @endlink instance used to transceive data.
- * @param payload A pointer to an area in memory where the raw data is copied from.
- * @param payload_size The size of the received (raw) CAN data.
- * @param out_size A reference to a variable which will contain the size of the actual (parsed) data.
+ * @param payload A pointer to an area in memory where the message is copied to.
+ * @param payload_size The size of @p payload.
+ * @param out_size A reference to a variable which will contain the size of the message.
  *
  * @return Possible return values:
  *      - @link ISOTP_RET_OK @endlink
  *      - @link ISOTP_RET_NO_DATA @endlink
+ *      - @link ISOTP_RET_OVERFLOW @endlink
+ */
+int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint32_t payload_size, uint32_t *out_size);
+
+/**
+ * @brief Leases the received message in place, without copying it out of the receive buffer.
+ *
+ * The returned view stays valid until @link isotp_receive_release @endlink is called.
+ * While leased, the link rejects new single frames and answers first frames with an overflow flow control.
+ *
+ * @param link The @link IsoTpLink @endlink instance used to transceive data.
+ * @param payload A reference to a pointer which will point at the received message.
+ * @param size A reference to a variable which will contain the size of the received message.
+ *
+ * @return Possible return values:
+ *      - @link ISOTP_RET_OK @endlink
+ *      - @link ISOTP_RET_NO_DATA @endlink
+ */
+int isotp_receive_lease(IsoTpLink *link, const uint8_t **payload, uint32_t *size);
+
+/**
+ * @brief Returns a leased receive buffer to the link, so it can accept the next message.
+ * @param link The @link IsoTpLink @endlink instance used to transceive data.
+ *
+ * @return Possible return values:
+ *      - @link ISOTP_RET_OK @endlink
+ *      - @link ISOTP_RET_NO_DATA @endlink if nothing was leased
+ */
+int isotp_receive_release(IsoTpLink *link);
+
+/**
+ * @brief Lets a streaming receive paused by on_receive_chunk continue.
+ *
+ * A sender held with FC.WAIT gets its clear to send right away. While paused, the link repeats
+ * FC.WAIT every ISO_TP_RECEIVE_WAIT_US up to wft_max times of its parameters, then aborts the
+ * reception with ISOTP_PROTOCOL_RESULT_WFT_OVRN. With a wft_max of 0 no FC.WAIT is sent at all, a pause
+ * at the end of a block aborts the reception with FC.OVFLW and the same result. Links with a block
+ * size of 0 can not hold the sender.
+ *
+ * @param link The @link IsoTpLink @endlink instance used to transceive data.
+ *
+ * @return Possible return values:
+ *      - @link ISOTP_RET_OK @endlink
+ *      - @link ISOTP_RET_HW_NOTREADY @endlink if the flow control frame could not be sent
  */
-int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size, uint16_t *out_size);
+int isotp_receive_resume(IsoTpLink *link);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,304 @@
+#ifndef __ISOTP_HPP__
+#define __ISOTP_HPP__
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "isotp.h"
+
+#if __cplusplus < 201703L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#error "isotp.hpp needs C++17"
+#endif
+
+namespace isotp {
+
+/**
+ * @brief How the CAN IDs of a link are formed.
+ */
+enum class Addressing {
+    Normal,         /* tx_id and rx_id of the config, 11 or 29 bit */
+    NormalFixed,    /* 29 bit physical IDs 0x18DA<TA><SA> from source_address and target_address */
+};
+
+/**
+ * @brief Defaults of a @code Link @endcode config, taken from isotp_config.h.
+ *
+ * Derive a config from it and shadow what differs, e.g.
+ * @code
+ * struct EngineEcu : isotp::LinkConfig {
+ *     static constexpr uint8_t  frame_size = 64;
+ *     static constexpr uint32_t tx_id = 0x7E0;
+ *     static constexpr uint32_t rx_id = 0x7E8;
+ *     static int send_can(void *ctx, uint32_t id, const uint8_t *data, uint8_t size);
+ *     static uint32_t get_us(void *ctx);
+ * };
+ * @endcode
+ *
+ * Protocol parameters of peers needing other timing go to @c params, e.g. BS 0 and STmin 0 for
+ * fast ones. Required of every config: @c send_can and @c get_us with the signatures of IsoTpUserOps, and
+ * @c tx_id and @c rx_id, or @c source_address and @c target_address for Addressing::NormalFixed.
+ * Optional, detected at compile time: @c debug as in IsoTpUserOps, and @c on_indication,
+ * @c on_ff_indication, @c on_confirm and @c on_receive_chunk as in IsoTpCallbacks without
+ * the link argument.
+ */
+struct LinkConfig {
+    static constexpr uint8_t    frame_size = 8;                 /* TX_DL, 8 for classic CAN, up to 64 for CAN FD */
+    static constexpr bool       padding = ISO_TP_FRAME_PADDING; /* pad frames shorter than 8 bytes to 8 */
+    static constexpr uint8_t    padding_byte = 0xCC;            /* also fills CAN FD frames up to a valid data length */
+    static constexpr uint32_t   send_buffer_size = 128;         /* 0 for links which only send without copy */
+    static constexpr uint32_t   receive_buffer_size = 128;
+    static constexpr Addressing addressing = Addressing::Normal;
+    static constexpr IsoTpLinkParams params = ISOTP_LINK_PARAMS_DEFAULT; /* its padding and padding_byte are replaced by the ones above */
+};
+
+namespace detail {
+
+template <typename Config, typename = void>
+struct has_debug : std::false_type {};
+template <typename Config>
+struct has_debug<Config, std::void_t<decltype(Config::debug(std::declval<void *>(), std::declval<const char *>()))>>
+    : std::true_type {};
+
+template <typename Config, typename = void>
+struct has_on_indication : std::false_type {};
+template <typename Config>
+struct has_on_indication<Config, std::void_t<decltype(Config::on_indication(std::declval<void *>(), 0,
+                                                                            std::declval<const uint8_t *>(), 0u))>>
+    : std::true_type {};
+
+template <typename Config, typename = void>
+struct has_on_ff_indication : std::false_type {};
+template <typename Config>
+struct has_on_ff_indication<Config, std::void_t<decltype(Config::on_ff_indication(std::declval<void *>(), 0u))>>
+    : std::true_type {};
+
+template <typename Config, typename = void>
+struct has_on_confirm : std::false_type {};
+template <typename Config>
+struct has_on_confirm<Config, std::void_t<decltype(Config::on_confirm(std::declval<void *>(), 0))>>
+    : std::true_type {};
+
+template <typename Config, typename = void>
+struct has_on_receive_chunk : std::false_type {};
+template <typename Config>
+struct has_on_receive_chunk<Config, std::void_t<decltype(Config::on_receive_chunk(std::declval<void *>(),
+                                                                                  std::declval<const uint8_t *>(), 0u, 0u))>>
+    : std::true_type {};
+
+constexpr bool is_can_dl(uint8_t dl)
+{
+    return 8 == dl || 12 == dl || 16 == dl || 20 == dl || 24 == dl || 32 == dl || 48 == dl || 64 == dl;
+}
+
+} // namespace detail
+
+/**
+ * @brief An @code IsoTpLink @endcode together with its buffers, configured at compile time.
+ *
+ * Links of different configs live side by side in one binary. The protocol is the one of isotp.c;
+ * frame size, padding, buffer sizes, IDs, protocol parameters and callbacks are fixed by @p Config, so they are checked
+ * when compiling and the transport and callback tables are constants. The buffers are members,
+ * nothing is allocated. A link holds pointers into itself and can therefore not be copied or moved.
+ */
+template <typename Config>
+class Link {
+public:
+    static constexpr uint8_t frame_size = Config::frame_size;
+
+    static_assert(detail::is_can_dl(Config::frame_size), "frame_size must be 8, 12, 16, 20, 24, 32, 48 or 64");
+    static_assert(Config::frame_size <= ISO_TP_MAX_FRAME_SIZE, "frame_size is above ISO_TP_MAX_FRAME_SIZE of the library");
+    static_assert(Config::params.st_min_us <= 127000, "STmin is above 127 ms");
+    static_assert(Config::receive_buffer_size > 0, "a link needs a receive buffer");
+
+    /* CAN ID the link sends with */
+    static constexpr uint32_t tx_id()
+    {
+        if constexpr (Addressing::NormalFixed == Config::addressing) {
+            return 0x18DA0000u | ((uint32_t)Config::target_address << 8) | Config::source_address;
+        } else {
+            return Config::tx_id;
+        }
+    }
+
+    /* CAN ID of the frames for the link, see on_can_message */
+    static constexpr uint32_t rx_id()
+    {
+        if constexpr (Addressing::NormalFixed == Config::addressing) {
+            return 0x18DA0000u | ((uint32_t)Config::source_address << 8) | Config::target_address;
+        } else {
+            return Config::rx_id;
+        }
+    }
+
+    /**
+     * @param ctx User context passed to every function of @p Config.
+     */
+    explicit Link(void *ctx = nullptr)
+    {
+        (void) isotp_init_link_static(&link_, tx_id(),
+                                      Config::send_buffer_size > 0 ? send_buffer_.data() : nullptr,
+                                      Config::send_buffer_size, receive_buffer_.data(), Config::receive_buffer_size);
+        isotp_set_user_ops(&link_, &ops_, ctx);
+        isotp_set_rx_id(&link_, rx_id());
+        (void) isotp_set_params(&link_, &params_);
+        if constexpr (Config::frame_size != 8) {
+            (void) isotp_set_tx_dl(&link_, Config::frame_size);
+        }
+        if constexpr (has_callbacks) {
+            isotp_set_callbacks(&link_, &callbacks_, ctx);
+        }
+    }
+
+    Link(const Link &) = delete;
+    Link &operator=(const Link &) = delete;
+
+    /* the C link, for the dispatcher, the timer wheel or the engine */
+    IsoTpLink *native()
+    {
+        return &link_;
+    }
+
+    /* see isotp_send */
+    int send(const uint8_t payload[], uint32_t size)
+    {
+        static_assert(Config::send_buffer_size > 0, "the link has no send buffer, use send_nocopy");
+        return isotp_send(&link_, payload, size);
+    }
+
+    /* see isotp_send_nocopy */
+    int send_nocopy(const uint8_t payload[], uint32_t size)
+    {
+        return isotp_send_nocopy(&link_, payload, size);
+    }
+
+    /* see isotp_on_can_message */
+    int on_can_message(const uint8_t *data, uint8_t len)
+    {
+        return isotp_on_can_message(&link_, data, len);
+    }
+
+    /* frames of other CAN IDs are ignored and return ISOTP_RET_NO_LINK */
+    int on_can_message(uint32_t id, const uint8_t *data, uint8_t len)
+    {
+        return (rx_id() == id) ? isotp_on_can_message(&link_, data, len) : ISOTP_RET_NO_LINK;
+    }
+
+    /* see isotp_on_can_messages, frames of other CAN IDs are skipped */
+    int on_can_messages(const IsoTpCanFrame frames[], uint16_t count)
+    {
+        return isotp_on_can_messages(&link_, frames, count);
+    }
+
+    /* see isotp_poll */
+    void poll()
+    {
+        isotp_poll(&link_);
+    }
+
+    /* see isotp_receive */
+    int receive(uint8_t *payload, uint32_t payload_size, uint32_t *out_size)
+    {
+        return isotp_receive(&link_, payload, payload_size, out_size);
+    }
+
+    /* see isotp_receive_lease and isotp_receive_release */
+    int receive_lease(const uint8_t **payload, uint32_t *size)
+    {
+        return isotp_receive_lease(&link_, payload, size);
+    }
+
+    int receive_release()
+    {
+        return isotp_receive_release(&link_);
+    }
+
+private:
+    static int send_can(void *ctx, const uint32_t arbitration_id, const uint8_t *data, const uint8_t size)
+    {
+        return Config::send_can(ctx, arbitration_id, data, size);
+    }
+
+    static uint32_t get_us(void *ctx)
+    {
+        return Config::get_us(ctx);
+    }
+
+    static void debug(void *ctx, const char *message)
+    {
+        Config::debug(ctx, message);
+    }
+
+    static void on_indication(IsoTpLink *, void *ctx, int result, const uint8_t *payload, uint32_t size)
+    {
+        Config::on_indication(ctx, result, payload, size);
+    }
+
+    static void on_ff_indication(IsoTpLink *, void *ctx, uint32_t size)
+    {
+        Config::on_ff_indication(ctx, size);
+    }
+
+    static void on_confirm(IsoTpLink *, void *ctx, int result)
+    {
+        Config::on_confirm(ctx, result);
+    }
+
+    static int on_receive_chunk(IsoTpLink *, void *ctx, const uint8_t *data, uint32_t offset, uint32_t size)
+    {
+        return Config::on_receive_chunk(ctx, data, offset, size);
+    }
+
+    static constexpr bool has_callbacks = detail::has_on_indication<Config>::value || detail::has_on_ff_indication<Config>::value ||
+                                          detail::has_on_confirm<Config>::value || detail::has_on_receive_chunk<Config>::value;
+
+    /* only the trampolines of functions the config has are instantiated */
+    static constexpr IsoTpUserOps make_ops()
+    {
+        IsoTpUserOps ops = { send_can, get_us, nullptr };
+        if constexpr (detail::has_debug<Config>::value) {
+            ops.debug = debug;
+        }
+        return ops;
+    }
+
+    static constexpr IsoTpCallbacks make_callbacks()
+    {
+        IsoTpCallbacks callbacks = { nullptr, nullptr, nullptr, nullptr };
+        if constexpr (detail::has_on_indication<Config>::value) {
+            callbacks.on_indication = on_indication;
+        }
+        if constexpr (detail::has_on_ff_indication<Config>::value) {
+            callbacks.on_ff_indication = on_ff_indication;
+        }
+        if constexpr (detail::has_on_confirm<Config>::value) {
+            callbacks.on_confirm = on_confirm;
+        }
+        if constexpr (detail::has_on_receive_chunk<Config>::value) {
+            callbacks.on_receive_chunk = on_receive_chunk;
+        }
+        return callbacks;
+    }
+
+    /* the library pads classic frames and fills CAN FD frames with padding_byte */
+    static constexpr IsoTpLinkParams make_params()
+    {
+        IsoTpLinkParams params = Config::params;
+        params.padding = Config::padding ? 1 : 0;
+        params.padding_byte = Config::padding_byte;
+        return params;
+    }
+
+    static constexpr IsoTpUserOps ops_ = make_ops();
+    static constexpr IsoTpLinkParams params_ = make_params();
+    static constexpr IsoTpCallbacks callbacks_ = make_callbacks();
+
+    IsoTpLink link_;
+    std::array<uint8_t, Config::send_buffer_size> send_buffer_;
+    std::array<uint8_t, Config::receive_buffer_size> receive_buffer_;
+};
+
+} // namespace isotp
+
+#endif // __ISOTP_HPP__
@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "isotp_classify.h"
+#include "isotp_codec.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ISOTP_CLASSIFY_SSE2 1
+#endif
+
+/* frames decoded per vector */
+#define ISOTP_CLASSIFY_LANES                ( 16 )
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+/* frame lengths accepted by isotp_on_can_message: 2 .. 8 and the CAN FD data lengths */
+static uint8_t isotp_classify_len_valid(uint8_t len) 
+{
+    return (len >= 2 && len <= 8) ||
+           (len <= ISO_TP_MAX_FRAME_SIZE && (12 == len || 16 == len || 20 == len || 24 == len || 32 == len || 48 == len || 64 == len));
+}
+
+/* type, nibble and length of frames from their first two bytes, escapes not resolved */
+static void isotp_classify_scalar(const uint8_t pci[], const uint8_t next[], const uint8_t valid[], uint32_t lanes,
+                                  uint8_t type[], uint8_t sn[], uint32_t length[]) 
+{
+    for (uint32_t lane = 0; lane < lanes; lane++) 
+    {
+        const uint8_t high = pci[lane] >> 4;
+        const uint8_t low = pci[lane] & 0x0F;
+
+        type[lane] = ISOTP_FRAME_TYPE_INVALID;
+        sn[lane] = 0;
+        length[lane] = 0;
+
+        if (valid[lane] && high <= ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME) 
+        {
+            type[lane] = high;
+            switch (high) 
+            {
+                case ISOTP_PCI_TYPE_SINGLE:
+                    length[lane] = low;
+                    break;
+                case ISOTP_PCI_TYPE_FIRST_FRAME:
+                    length[lane] = ((uint32_t)low << 8) | next[lane];
+                    break;
+                case TSOTP_PCI_TYPE_CONSECUTIVE_FRAME:
+                    sn[lane] = low;
+                    break;
+                default:
+                    sn[lane] = low;
+                    length[lane] = next[lane];
+                    break;
+            }
+        }
+    }
+}
+
+#if defined(ISOTP_CLASSIFY_SSE2)
+/* same as isotp_classify_scalar for ISOTP_CLASSIFY_LANES frames */
+static void isotp_classify_sse2(const uint8_t pci[], const uint8_t next[], const uint8_t valid[],
+                                uint8_t type[], uint8_t sn[], uint32_t length[]) 
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i b0 = _mm_loadu_si128((const __m128i *)pci);
+    const __m128i b1 = _mm_loadu_si128((const __m128i *)next);
+    const __m128i ok = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)valid), _mm_set1_epi8(1));
+    const __m128i low = _mm_and_si128(b0, nibble);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(b0, 4), nibble);
+    const __m128i is_sf = _mm_cmpeq_epi8(high, _mm_set1_epi8(ISOTP_PCI_TYPE_SINGLE));
+    const __m128i is_ff = _mm_cmpeq_epi8(high, _mm_set1_epi8(ISOTP_PCI_TYPE_FIRST_FRAME));
+    const __m128i is_cf = _mm_cmpeq_epi8(high, _mm_set1_epi8(TSOTP_PCI_TYPE_CONSECUTIVE_FRAME));
+    const __m128i is_fc = _mm_cmpeq_epi8(high, _mm_set1_epi8(ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME));
+    const __m128i known = _mm_and_si128(ok, _mm_or_si128(_mm_or_si128(is_sf, is_ff), _mm_or_si128(is_cf, is_fc)));
+    /* unknown types and bad lengths become 0xFF */
+    const __m128i types = _mm_or_si128(_mm_and_si128(known, high), _mm_andnot_si128(known, _mm_set1_epi8((char)0xFF)));
+    const __m128i sns = _mm_and_si128(_mm_and_si128(known, _mm_or_si128(is_cf, is_fc)), low);
+    /* length low byte: SF_DL, FF_DL low byte or BS; high byte: FF_DL high nibble */
+    const __m128i len_lo = _mm_and_si128(known, _mm_or_si128(_mm_and_si128(is_sf, low),
+                                                              _mm_and_si128(_mm_or_si128(is_ff, is_fc), b1)));
+    const __m128i len_hi = _mm_and_si128(_mm_and_si128(known, is_ff), low);
+    const __m128i len_16_lo = _mm_unpacklo_epi8(len_lo, len_hi);
+    const __m128i len_16_hi = _mm_unpackhi_epi8(len_lo, len_hi);
+    const __m128i zero = _mm_setzero_si128();
+
+    _mm_storeu_si128((__m128i *)type, types);
+    _mm_storeu_si128((__m128i *)sn, sns);
+    _mm_storeu_si128((__m128i *)&length[0], _mm_unpacklo_epi16(len_16_lo, zero));
+    _mm_storeu_si128((__m128i *)&length[4], _mm_unpackhi_epi16(len_16_lo, zero));
+    _mm_storeu_si128((__m128i *)&length[8], _mm_unpacklo_epi16(len_16_hi, zero));
+    _mm_storeu_si128((__m128i *)&length[12], _mm_unpackhi_epi16(len_16_hi, zero));
+}
+#endif
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+uint32_t isotp_classify_frames(const IsoTpCanFrame frames[], uint32_t count, const IsoTpFrameClasses *classes) 
+{
+    assert( frames != NULL || 0 == count );
+    assert( classes != NULL );
+
+    uint32_t valid_frames = 0;
+
+    for (uint32_t base = 0; base < count; base += ISOTP_CLASSIFY_LANES) 
+    {
+        const uint32_t lanes = (count - base < ISOTP_CLASSIFY_LANES) ? count - base : ISOTP_CLASSIFY_LANES;
+        uint8_t pci[ISOTP_CLASSIFY_LANES];
+        uint8_t next[ISOTP_CLASSIFY_LANES];
+        uint8_t valid[ISOTP_CLASSIFY_LANES];
+
+        /* gather the PCI bytes, frames are too far apart for a vector load */
+        for (uint32_t lane = 0; lane < lanes; lane++) 
+        {
+            const IsoTpCanFrame *frame = &frames[base + lane];
+
+            valid[lane] = isotp_classify_len_valid(frame->len);
+            pci[lane] = frame->data[0];
+            next[lane] = frame->data[1];
+        }
+
+#if defined(ISOTP_CLASSIFY_SSE2)
+        if (ISOTP_CLASSIFY_LANES == lanes) 
+        {
+            isotp_classify_sse2(pci, next, valid, &classes->type[base], &classes->sn[base], &classes->length[base]);
+
+        } else {
+
+            isotp_classify_scalar(pci, next, valid, lanes, &classes->type[base], &classes->sn[base], &classes->length[base]);
+        }
+#else
+        isotp_classify_scalar(pci, next, valid, lanes, &classes->type[base], &classes->sn[base], &classes->length[base]);
+#endif
+
+        /* escaped lengths */
+        for (uint32_t lane = 0; lane < lanes; lane++) 
+        {
+            const IsoTpCanFrame *frame = &frames[base + lane];
+            const uint32_t index = base + lane;
+
+            if (ISOTP_FRAME_TYPE_INVALID != classes->type[index]) 
+            {
+                valid_frames += 1;
+            }
+
+            if (ISOTP_PCI_TYPE_SINGLE == classes->type[index] && frame->len > 8) 
+            {
+                /* frames longer than 8 bytes must use the escape, SF_DL in the nibble is invalid */
+                classes->length[index] = (0 == classes->length[index]) ? frame->data[ISOTP_CODEC_SF_ESC_DL] : 0;
+
+            } else if (ISOTP_PCI_TYPE_FIRST_FRAME == classes->type[index] && 0 == classes->length[index] && frame->len >= 6) {
+
+                const uint32_t ff_dl = isotp_codec_get_be32(&frame->data[ISOTP_CODEC_FF_ESC_DL]);
+
+                /* a length fitting 12 bit must not be escaped */
+                classes->length[index] = (ff_dl > ISOTP_MAX_FF_DL) ? ff_dl : 0;
+            }
+        }
+    }
+
+    return valid_frames;
+}
@@ -0,0 +1,54 @@
+#ifndef __ISOTP_CLASSIFY_H__
+#define __ISOTP_CLASSIFY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/* type of a frame which is no ISO-TP frame: bad length or unknown PCI type */
+#define ISOTP_FRAME_TYPE_INVALID            ( 0xFF )
+
+/**
+ * @brief Decoded PCI of a batch of frames, one array element per frame.
+ */
+typedef struct IsoTpFrameClasses {
+    uint8_t*                    type;             /* ISOTP_PCI_TYPE_* or ISOTP_FRAME_TYPE_INVALID */
+    uint8_t*                    sn;               /* SN of a consecutive frame, FS of a flow control frame, else 0 */
+    uint32_t*                   length;           /* SF_DL or FF_DL, escapes resolved; BS of a flow control frame; else 0 */
+} IsoTpFrameClasses;
+
+/**
+ * @brief Decodes the protocol control information of many frames at once.
+ *
+ * Frames are taken 16 at a time: their first two bytes are gathered and split into type,
+ * nibble and length with SSE2 shifts and masks, or one frame at a time without SSE2. Only the
+ * rare escaped lengths (CAN FD single frames, first frames above 4095 bytes) are decoded per frame;
+ * an escaped FF_DL below 4096 is invalid and yields length 0. Lengths are not checked against the
+ * frame size, the receive path still does that.
+ *
+ * @param frames The frames, e.g. a drained driver FIFO or a replayed log.
+ * @param count The number of frames.
+ * @param classes Output arrays of at least @p count elements each.
+ * @return The number of frames which are not ISOTP_FRAME_TYPE_INVALID.
+ */
+uint32_t isotp_classify_frames(const IsoTpCanFrame frames[], uint32_t count, const IsoTpFrameClasses *classes);
+
+/**
+ * @brief See @link isotp_on_can_message_at @endlink, for a frame classified by @link isotp_classify_frames @endlink.
+ * The receive path takes the decoded type, SN and length instead of decoding the PCI again.
+ *
+ * @param type, sn, length The elements of the frame in @code IsoTpFrameClasses @endcode.
+ * @return ISOTP_RET_LENGTH for ISOTP_FRAME_TYPE_INVALID, otherwise as @link isotp_on_can_message @endlink.
+ */
+int isotp_on_can_message_classified(IsoTpLink *link, const uint8_t *data, uint8_t len,
+                                    uint8_t type, uint8_t sn, uint32_t length, IsoTpClock *clock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_CLASSIFY_H__
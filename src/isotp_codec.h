@@ -0,0 +1,139 @@
+#ifndef __ISOTP_CODEC_H__
+#define __ISOTP_CODEC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp_defines.h"
+
+/**************************************************************
+ * protocol control information codec
+ *
+ * Frames are read and written in place, byte by byte with shifts and masks, so the result
+ * does not depend on the compiler's bitfield layout or on the byte order of the target.
+ *************************************************************/
+
+/*
+* single frame
+* +-------------------------+-----+
+* | byte #0                 | ... |
+* +-------------------------+-----+
+* | nibble #0   | nibble #1 | ... |
+* +-------------+-----------+ ... +
+* | PCIType = 0 | SF_DL     | ... |
+* +-------------+-----------+-----+
+*
+* CAN FD frames longer than 8 bytes escape the length,
+* SF_DL = 0 and the real SF_DL follows in byte #1
+*
+* first frame
+* +-------------------------+-----------------------+-----+
+* | byte #0                 | byte #1               | ... |
+* +-------------------------+-----------+-----------+-----+
+* | nibble #0   | nibble #1 | nibble #2 | nibble #3 | ... |
+* +-------------+-----------+-----------+-----------+-----+
+* | PCIType = 1 | FF_DL                             | ... |
+* +-------------+-----------+-----------------------+-----+
+*
+* messages above 4095 bytes escape the length,
+* FF_DL = 0 and the real FF_DL follows big endian in bytes #2 - #5
+*
+* consecutive frame
+* +-------------------------+-----+
+* | byte #0                 | ... |
+* +-------------------------+-----+
+* | nibble #0   | nibble #1 | ... |
+* +-------------+-----------+ ... +
+* | PCIType = 2 | SN        | ... |
+* +-------------+-----------+-----+
+*
+* flow control frame
+* +-------------------------+-----------------------+-----------------------+-----+
+* | byte #0                 | byte #1               | byte #2               | ... |
+* +-------------------------+-----------+-----------+-----------+-----------+-----+
+* | nibble #0   | nibble #1 | nibble #2 | nibble #3 | nibble #4 | nibble #5 | ... |
+* +-------------+-----------+-----------+-----------+-----------+-----------+-----+
+* | PCIType = 3 | FS        | BS                    | STmin                 | ... |
+* +-------------+-----------+-----------------------+-----------------------+-----+
+*/
+
+/* PCI byte offsets */
+#define ISOTP_CODEC_SF_ESC_DL           1   /* escaped SF_DL */
+#define ISOTP_CODEC_FF_DL_LOW           1
+#define ISOTP_CODEC_FF_ESC_DL           2   /* escaped 32 bit FF_DL */
+#define ISOTP_CODEC_FC_BS               1
+#define ISOTP_CODEC_FC_STMIN            2
+
+/* PCIType, an ISOTP_PCI_TYPE_* value */
+static inline uint8_t isotp_codec_type(const uint8_t *frame)
+{
+    return (uint8_t) (frame[0] >> 4);
+}
+
+/* low nibble of the first byte: SF_DL, FF_DL high bits, SN or FS */
+static inline uint8_t isotp_codec_nibble(const uint8_t *frame)
+{
+    return (uint8_t) (frame[0] & 0x0F);
+}
+
+/* 12 bit FF_DL of a first frame, 0 if escaped */
+static inline uint32_t isotp_codec_ff_dl(const uint8_t *frame)
+{
+    return ((uint32_t) (frame[0] & 0x0F) << 8) | frame[ISOTP_CODEC_FF_DL_LOW];
+}
+
+static inline uint32_t isotp_codec_get_be32(const uint8_t *data)
+{
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+static inline void isotp_codec_put_be32(uint8_t *data, uint32_t value)
+{
+    data[0] = (uint8_t) (value >> 24);
+    data[1] = (uint8_t) (value >> 16);
+    data[2] = (uint8_t) (value >> 8);
+    data[3] = (uint8_t) value;
+}
+
+/* first byte of any frame */
+static inline void isotp_codec_put_pci(uint8_t *frame, uint8_t type, uint8_t nibble)
+{
+    frame[0] = (uint8_t) ((type << 4) | (nibble & 0x0F));
+}
+
+/* first frame header, FF_DL above 4095 is escaped; returns the header length */
+static inline uint8_t isotp_codec_put_ff(uint8_t *frame, uint32_t ff_dl)
+{
+    uint8_t pci_length = 2;
+
+    if (ff_dl <= ISOTP_MAX_FF_DL)
+    {
+        isotp_codec_put_pci(frame, ISOTP_PCI_TYPE_FIRST_FRAME, (uint8_t) (ff_dl >> 8));
+        frame[ISOTP_CODEC_FF_DL_LOW] = (uint8_t) ff_dl;
+
+    } else {
+
+        isotp_codec_put_pci(frame, ISOTP_PCI_TYPE_FIRST_FRAME, 0);
+        frame[ISOTP_CODEC_FF_DL_LOW] = 0;
+        isotp_codec_put_be32(&frame[ISOTP_CODEC_FF_ESC_DL], ff_dl);
+        pci_length += 4;
+    }
+
+    return pci_length;
+}
+
+static inline void isotp_codec_put_fc(uint8_t *frame, uint8_t fs, uint8_t bs, uint8_t st_min)
+{
+    isotp_codec_put_pci(frame, ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME, fs);
+    frame[ISOTP_CODEC_FC_BS] = bs;
+    frame[ISOTP_CODEC_FC_STMIN] = st_min;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_CODEC_H__
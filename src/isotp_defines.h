@@ -4,15 +4,41 @@
 /**************************************************************
  * compiler specific defines
  *************************************************************/
+/* uint32_t index handoff between a producer and a consumer context, e.g. ISR and task */
 #ifdef __GNUC__
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-
-#elif __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ISOTP_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ISOTP_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
 #else
-#error "unsupported byte ordering"
+/* single core targets only, the compiler must not cache or reorder volatile accesses */
+#define ISOTP_LOAD_ACQUIRE(p)        (*(volatile uint32_t *)(p))
+#define ISOTP_STORE_RELEASE(p, v)    (*(volatile uint32_t *)(p) = (v))
+#endif
+
+/* pointer handoff between any number of producer threads and one consumer, see isotp_submit.h;
+ * other compilers define these in isotp_config.h to build isotp_submit.c */
+#ifdef __GNUC__
+#define ISOTP_LOAD_ACQUIRE_PTR(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ISOTP_STORE_RELEASE_PTR(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ISOTP_EXCHANGE_PTR(p, v)         __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#endif
+
+/* data shared by two contexts is kept this far apart to avoid false sharing */
+#ifndef ISOTP_CACHE_LINE_SIZE
+#define ISOTP_CACHE_LINE_SIZE        64
 #endif
+
+/* starts a struct member on an n byte boundary, where the compiler supports it */
+#if defined(__GNUC__)
+#define ISOTP_ALIGNED(n)             __attribute__((aligned(n)))
+#elif defined(_MSC_VER)
+#define ISOTP_ALIGNED(n)             __declspec(align(n))
+#else
+#define ISOTP_ALIGNED(n)
 #endif
 
+/* compile time check, usable where declarations are */
+#define ISOTP_STATIC_ASSERT(cond, name)  typedef char isotp_static_assert_##name[(cond) ? 1 : -1]
+
 /**************************************************************
  * OS specific defines
  *************************************************************/
@@ -39,10 +65,26 @@
 #define ISOTP_RET_TIMEOUT      -6
 #define ISOTP_RET_LENGTH       -7
 #define ISOTP_RET_HW_NOTREADY  -8
+#define ISOTP_RET_NO_LINK      -9
 
 /* return logic true if 'a' is after 'b' */
 #define IsoTpTimeAfter(a,b) ((int32_t)((int32_t)(b) - (int32_t)(a)) < 0)
 
+/* largest CAN frame the codec handles, 8 for classic CAN, up to 64 for CAN FD */
+#ifndef ISO_TP_MAX_FRAME_SIZE
+#define ISO_TP_MAX_FRAME_SIZE  64
+#endif
+
+#if ISO_TP_MAX_FRAME_SIZE < 8 || ISO_TP_MAX_FRAME_SIZE > 64
+#error "ISO_TP_MAX_FRAME_SIZE must be within 8 and 64"
+#endif
+
+/* max payload length encodable in the 12 bit FF_DL, longer messages use the 32 bit escape */
+#define ISOTP_MAX_FF_DL        0x0FFF
+
+/* receive ID of a link none was set for, CAN IDs are at most 29 bit */
+#define ISOTP_NO_RX_ID         0xFFFFFFFFu
+
 /*  invalid bs */
 #define ISOTP_INVALID_BS       0xFFFF
 
@@ -58,135 +100,15 @@ typedef enum {
     ISOTP_RECEIVE_STATUS_IDLE,
     ISOTP_RECEIVE_STATUS_INPROGRESS,
     ISOTP_RECEIVE_STATUS_FULL,
+    ISOTP_RECEIVE_STATUS_LEASED,
 } IsoTpReceiveStatusTypes;
 
-/* can fram defination */
-#if defined( ISOTP_BYTE_ORDER_BIG_ENDIAN )
-
-typedef struct {
-    uint8_t type:4;
-    uint8_t reserve_1:4;
-    uint8_t reserve_2[7];
-} IsoTpPciType;
-
-/*
-* single frame
-* +-------------------------+-----+
-* | byte #0                 | ... |
-* +-------------------------+-----+
-* | nibble #0   | nibble #1 | ... |
-* +-------------+-----------+ ... +
-* | PCIType = 0 | SF_DL     | ... |
-* +-------------+-----------+-----+
-*/
-typedef struct {
-    uint8_t type:4;
-    uint8_t SF_DL:4;
-    uint8_t data[7];
-} IsoTpSingleFrame;
-
-/*
-* first frame
-* +-------------------------+-----------------------+-----+
-* | byte #0                 | byte #1               | ... |
-* +-------------------------+-----------+-----------+-----+
-* | nibble #0   | nibble #1 | nibble #2 | nibble #3 | ... |
-* +-------------+-----------+-----------+-----------+-----+
-* | PCIType = 1 | FF_DL                             | ... |
-* +-------------+-----------+-----------------------+-----+
-*/
-typedef struct {
-    uint8_t type:4;
-    uint8_t FF_DL_high:4;
-    uint8_t FF_DL_low;
-    uint8_t data[6];
-} IsoTpFirstFrame;
-
-/*
-* consecutive frame
-* +-------------------------+-----+
-* | byte #0                 | ... |
-* +-------------------------+-----+
-* | nibble #0   | nibble #1 | ... |
-* +-------------+-----------+ ... +
-* | PCIType = 0 | SN        | ... |
-* +-------------+-----------+-----+
-*/
-typedef struct {
-    uint8_t type:4;
-    uint8_t SN:4;
-    uint8_t data[7];
-} IsoTpConsecutiveFrame;
-
-/*
-* flow control frame
-* +-------------------------+-----------------------+-----------------------+-----+
-* | byte #0                 | byte #1               | byte #2               | ... |
-* +-------------------------+-----------+-----------+-----------+-----------+-----+
-* | nibble #0   | nibble #1 | nibble #2 | nibble #3 | nibble #4 | nibble #5 | ... |
-* +-------------+-----------+-----------+-----------+-----------+-----------+-----+
-* | PCIType = 1 | FS        | BS                    | STmin                 | ... |
-* +-------------+-----------+-----------------------+-----------------------+-----+
-*/
-typedef struct {
-    uint8_t type:4;
-    uint8_t FS:4;
-    uint8_t BS;
-    uint8_t STmin;
-    uint8_t reserve[5];
-} IsoTpFlowControl;
-
-#else
-
-typedef struct {
-    uint8_t reserve_1:4;
-    uint8_t type:4;
-    uint8_t reserve_2[7];
-} IsoTpPciType;
-
-typedef struct {
-    uint8_t SF_DL:4;
-    uint8_t type:4;
-    uint8_t data[7];
-} IsoTpSingleFrame;
-
-typedef struct {
-    uint8_t FF_DL_high:4;
-    uint8_t type:4;
-    uint8_t FF_DL_low;
-    uint8_t data[6];
-} IsoTpFirstFrame;
-
-typedef struct {
-    uint8_t SN:4;
-    uint8_t type:4;
-    uint8_t data[7];
-} IsoTpConsecutiveFrame;
-
-typedef struct {
-    uint8_t FS:4;
-    uint8_t type:4;
-    uint8_t BS;
-    uint8_t STmin;
-    uint8_t reserve[5];
-} IsoTpFlowControl;
-
-#endif
-
-typedef struct {
-    uint8_t ptr[8];
-} IsoTpDataArray;
-
+/* raw can frame, as delivered by the driver */
 typedef struct {
-    union {
-        IsoTpPciType          common;
-        IsoTpSingleFrame      single_frame;
-        IsoTpFirstFrame       first_frame;
-        IsoTpConsecutiveFrame consecutive_frame;
-        IsoTpFlowControl      flow_control;
-        IsoTpDataArray        data_array;
-    } as;
-} IsoTpCanMessage;
+    uint32_t arbitration_id;
+    uint8_t  len;
+    uint8_t  data[ISO_TP_MAX_FRAME_SIZE];
+} IsoTpCanFrame;
 
 /**************************************************************
  * protocol specific defines
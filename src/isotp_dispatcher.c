@@ -0,0 +1,262 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "isotp_dispatcher.h"
+#include "isotp_classify.h"
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+/* spread (bus, id) over the table, murmur3 finalizer */
+static uint32_t isotp_dispatcher_hash(uint8_t bus, uint32_t rx_id) 
+{
+    uint32_t h = rx_id ^ ((uint32_t)bus << 29) ^ ((uint32_t)bus << 11);
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/* index of the slot holding (bus, id), or of the free slot ending its probe sequence */
+static uint32_t isotp_dispatcher_probe(const IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id) 
+{
+    uint32_t index = isotp_dispatcher_hash(bus, rx_id) & dispatcher->mask;
+    const IsoTpDispatcherEntry *entry = &dispatcher->entries[index];
+
+    while (entry->used && (entry->receive_arbitration_id != rx_id || entry->bus != bus)) 
+    {
+        index = (index + 1) & dispatcher->mask;
+        entry = &dispatcher->entries[index];
+    }
+
+    return index;
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+int isotp_dispatcher_init(IsoTpDispatcher *dispatcher, IsoTpDispatcherEntry *entries, uint32_t capacity) 
+{
+    assert( dispatcher != NULL );
+    assert( entries != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    /* capacity must be a power of two */
+    if (capacity < 2 || 0 != (capacity & (capacity - 1))) 
+    {
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        (void) memset(entries, 0, capacity * sizeof(IsoTpDispatcherEntry));
+        dispatcher->entries = entries;
+        dispatcher->mask = capacity - 1;
+        dispatcher->count = 0;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_dispatcher_register(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id, IsoTpLink *link) 
+{
+    assert( dispatcher != NULL );
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    /* keep load below 3/4, probe sequences stay short and always end */
+    if ((dispatcher->count + 1) * 4 > (dispatcher->mask + 1) * 3) 
+    {
+        ret = ISOTP_RET_OVERFLOW;
+
+    } else {
+
+        IsoTpDispatcherEntry *entry = &dispatcher->entries[isotp_dispatcher_probe(dispatcher, bus, rx_id)];
+
+        if (entry->used) 
+        {
+            ret = ISOTP_RET_ERROR;
+
+        } else {
+
+            entry->receive_arbitration_id = rx_id;
+            entry->bus = bus;
+            entry->link = link;
+            entry->used = 1;
+            dispatcher->count += 1;
+
+            link->receive_arbitration_id = rx_id;
+
+            ret = ISOTP_RET_OK;
+        }
+    }
+
+    return ret;
+}
+
+int isotp_dispatcher_unregister(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id) 
+{
+    assert( dispatcher != NULL );
+
+    int ret = ISOTP_RET_NO_LINK;
+    uint32_t hole = isotp_dispatcher_probe(dispatcher, bus, rx_id);
+
+    if (dispatcher->entries[hole].used) 
+    {
+        /* backward shift deletion, entries behind the hole move up if their home allows it */
+        uint32_t index = hole;
+
+        for (;;) 
+        {
+            index = (index + 1) & dispatcher->mask;
+            IsoTpDispatcherEntry *entry = &dispatcher->entries[index];
+
+            if (!entry->used) 
+            {
+                break;
+            }
+
+            const uint32_t home = isotp_dispatcher_hash(entry->bus, entry->receive_arbitration_id) & dispatcher->mask;
+            /* move if home is not cyclically within (hole, index] */
+            if (((index - home) & dispatcher->mask) >= ((index - hole) & dispatcher->mask)) 
+            {
+                dispatcher->entries[hole] = *entry;
+                hole = index;
+            }
+        }
+
+        dispatcher->entries[hole].used = 0;
+        dispatcher->entries[hole].link = NULL;
+        dispatcher->count -= 1;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+IsoTpLink* isotp_dispatcher_find(const IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id) 
+{
+    assert( dispatcher != NULL );
+
+    /* load is capped below 1, probing always reaches a free slot */
+    const IsoTpDispatcherEntry *entry = &dispatcher->entries[isotp_dispatcher_probe(dispatcher, bus, rx_id)];
+
+    return entry->used ? entry->link : NULL;
+}
+
+int isotp_dispatcher_on_can_message(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t id, const uint8_t *data, uint8_t len) 
+{
+    assert( dispatcher != NULL );
+
+    int ret = ISOTP_RET_NO_LINK;
+    IsoTpLink *link = isotp_dispatcher_find(dispatcher, bus, id);
+
+    if (link != NULL) 
+    {
+        ret = isotp_on_can_message(link, data, len);
+    }
+
+    return ret;
+}
+
+int isotp_dispatcher_on_can_messages(IsoTpDispatcher *dispatcher, uint8_t bus, const IsoTpCanFrame frames[], uint16_t count) 
+{
+    assert( dispatcher != NULL );
+    assert( frames != NULL );
+
+    int ret = ISOTP_RET_OK;
+    IsoTpClock clock = { 0, 0 };
+    uint8_t type[16];
+    uint8_t sn[16];
+    uint32_t length[16];
+    const IsoTpFrameClasses classes = { type, sn, length };
+
+    for (uint16_t base = 0; base < count; base += 16) 
+    {
+        const uint16_t chunk = (count - base < 16) ? count - base : 16;
+
+        /* malformed frames are dropped before the table lookup, the others are not decoded again */
+        (void) isotp_classify_frames(&frames[base], chunk, &classes);
+
+        for (uint16_t index = 0; index < chunk; index++) 
+        {
+            const IsoTpCanFrame *frame = &frames[base + index];
+            int frame_ret = ISOTP_RET_LENGTH;
+
+            if (ISOTP_FRAME_TYPE_INVALID != type[index]) 
+            {
+                IsoTpLink *link = isotp_dispatcher_find(dispatcher, bus, frame->arbitration_id);
+
+                frame_ret = ISOTP_RET_NO_LINK;
+                if (link != NULL) 
+                {
+                    frame_ret = isotp_on_can_message_classified(link, frame->data, frame->len,
+                                                                type[index], sn[index], length[index], &clock);
+                }
+            }
+
+            if (ISOTP_RET_OK != frame_ret) 
+            {
+                ret = frame_ret;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void isotp_dispatcher_poll(IsoTpDispatcher *dispatcher) 
+{
+    assert( dispatcher != NULL );
+
+    for (uint32_t index = 0; index <= dispatcher->mask; index++) 
+    {
+        if (dispatcher->entries[index].used) 
+        {
+            isotp_poll(dispatcher->entries[index].link);
+        }
+    }
+
+    return;
+}
+
+int isotp_dispatcher_next_deadline(const IsoTpDispatcher *dispatcher, uint32_t *deadline_us) 
+{
+    assert( dispatcher != NULL );
+    assert( deadline_us != NULL );
+
+    int ret = ISOTP_RET_NO_DATA;
+    uint32_t deadline = 0;
+
+    for (uint32_t index = 0; index <= dispatcher->mask; index++) 
+    {
+        uint32_t link_deadline;
+
+        if (dispatcher->entries[index].used &&
+            ISOTP_RET_OK == isotp_next_deadline(dispatcher->entries[index].link, &link_deadline)) 
+        {
+            if (ISOTP_RET_NO_DATA == ret || IsoTpTimeAfter(deadline, link_deadline)) 
+            {
+                deadline = link_deadline;
+            }
+            ret = ISOTP_RET_OK;
+        }
+    }
+
+    if (ISOTP_RET_OK == ret) 
+    {
+        *deadline_us = deadline;
+    }
+
+    return ret;
+}
@@ -0,0 +1,101 @@
+#ifndef __ISOTP_DISPATCHER_H__
+#define __ISOTP_DISPATCHER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/**
+ * @brief One slot of the dispatcher table. Slots are provided by the application.
+ */
+typedef struct IsoTpDispatcherEntry {
+    uint32_t                    receive_arbitration_id;
+    uint8_t                     bus;
+    uint8_t                     used;
+    IsoTpLink*                  link;
+} IsoTpDispatcherEntry;
+
+/**
+ * @brief Routes received CAN frames to the link registered for (bus, CAN ID).
+ * Lookup uses an open-addressed hash table with linear probing, so a frame is
+ * dispatched in constant time however many links are registered.
+ */
+typedef struct IsoTpDispatcher {
+    IsoTpDispatcherEntry*       entries;
+    uint32_t                    mask;  /* capacity - 1 */
+    uint32_t                    count;
+} IsoTpDispatcher;
+
+/**
+ * @brief Initialises a dispatcher on top of an application provided table.
+ *
+ * @param dispatcher The @code IsoTpDispatcher @endcode instance.
+ * @param entries The table storage. At most 3/4 of it is filled, so size it
+ *                with room to spare for short probe sequences.
+ * @param capacity The number of entries; must be a power of two.
+ * @return ISOTP_RET_OK or ISOTP_RET_ERROR if the capacity is invalid.
+ */
+int isotp_dispatcher_init(IsoTpDispatcher *dispatcher, IsoTpDispatcherEntry *entries, uint32_t capacity);
+
+/**
+ * @brief Registers a link for frames with the given CAN ID on the given bus.
+ * The ID is stored in the link as receive_arbitration_id.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_OVERFLOW @endcode if the table is full
+ *  - @code ISOTP_RET_ERROR @endcode if the (bus, CAN ID) pair is already registered
+ */
+int isotp_dispatcher_register(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id, IsoTpLink *link);
+
+/**
+ * @brief Removes the link registered for the given bus and CAN ID.
+ * @return ISOTP_RET_OK or ISOTP_RET_NO_LINK.
+ */
+int isotp_dispatcher_unregister(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id);
+
+/**
+ * @brief Looks up the link registered for the given bus and CAN ID.
+ * @return The link or NULL.
+ */
+IsoTpLink* isotp_dispatcher_find(const IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t rx_id);
+
+/**
+ * @brief Hands a received CAN frame to the link registered for its bus and CAN ID.
+ *
+ * @return ISOTP_RET_NO_LINK if no link listens to the frame, otherwise the
+ *         return value of @link isotp_on_can_message @endlink.
+ */
+int isotp_dispatcher_on_can_message(IsoTpDispatcher *dispatcher, uint8_t bus, uint32_t id, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Hands a batch of CAN frames received on one bus to their links.
+ * The clock is read at most once for the whole batch, so all links of the bus must share a time base.
+ * The batch is classified first, see @link isotp_classify_frames @endlink; frames which are no
+ * ISO-TP frames fail with ISOTP_RET_LENGTH without a table lookup, the others are handed to their
+ * link with their decoded PCI, see @link isotp_on_can_message_classified @endlink.
+ *
+ * @return ISOTP_RET_OK if every frame was handled, otherwise the error of the last frame which failed.
+ */
+int isotp_dispatcher_on_can_messages(IsoTpDispatcher *dispatcher, uint8_t bus, const IsoTpCanFrame frames[], uint16_t count);
+
+/**
+ * @brief Calls @link isotp_poll @endlink for every registered link.
+ */
+void isotp_dispatcher_poll(IsoTpDispatcher *dispatcher);
+
+/**
+ * @brief Returns the earliest @link isotp_next_deadline @endlink of all registered links.
+ * @return ISOTP_RET_OK, or ISOTP_RET_NO_DATA if no link has a pending timer.
+ */
+int isotp_dispatcher_next_deadline(const IsoTpDispatcher *dispatcher, uint32_t *deadline_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_DISPATCHER_H__
@@ -0,0 +1,354 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+#include <time.h>
+
+#include "isotp_engine.h"
+
+#if ISO_TP_NO_HEAP
+#error "isotp_engine.c allocates its shards, build it without ISO_TP_NO_HEAP"
+#endif
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+static int isotp_engine_is_pow2(uint32_t value) 
+{
+    return value >= 2 && 0 == (value & (value - 1));
+}
+
+/* zeroed memory starting on a cache line */
+static void* isotp_engine_alloc(size_t size) 
+{
+    void *memory = NULL;
+
+    if (0 != posix_memalign(&memory, ISOTP_CACHE_LINE_SIZE, size)) 
+    {
+        memory = NULL;
+
+    } else {
+
+        (void) memset(memory, 0, size);
+    }
+
+    return memory;
+}
+
+static void isotp_engine_shard_free(IsoTpEngineShard *shard) 
+{
+    if (shard != NULL) 
+    {
+        if (shard->rx_rings != NULL) 
+        {
+            /* frames of all buses are one block */
+            free(shard->rx_rings[0].frames);
+        }
+        free(shard->rx_rings);
+        free(shard->dispatcher.entries);
+        free(shard->wheel.slots);
+        free(shard);
+    }
+}
+
+static IsoTpEngineShard* isotp_engine_shard_create(IsoTpEngine *engine, const IsoTpEngineConfig *config, uint16_t index) 
+{
+    IsoTpEngineShard *shard = isotp_engine_alloc(sizeof(IsoTpEngineShard));
+    IsoTpDispatcherEntry *entries = NULL;
+    IsoTpTimer **slots = NULL;
+    IsoTpCanFrame *frames = NULL;
+
+    if (shard != NULL) 
+    {
+        shard->engine = engine;
+        shard->cpu = (config->cpus != NULL) ? config->cpus[index] : -1;
+        isotp_submit_queue_init(&shard->submit_queue);
+
+        entries = calloc(config->links_per_shard, sizeof(IsoTpDispatcherEntry));
+        slots = calloc(config->wheel_slots, sizeof(IsoTpTimer *));
+        frames = calloc((size_t)config->bus_count * config->ring_size, sizeof(IsoTpCanFrame));
+        shard->rx_rings = isotp_engine_alloc(config->bus_count * sizeof(IsoTpFrameRing));
+
+        if (NULL == entries || NULL == slots || NULL == frames || NULL == shard->rx_rings) 
+        {
+            free(entries);
+            free(slots);
+            free(frames);
+            free(shard->rx_rings);
+            free(shard);
+            shard = NULL;
+
+        } else {
+
+            (void) isotp_dispatcher_init(&shard->dispatcher, entries, config->links_per_shard);
+            (void) isotp_timer_wheel_init(&shard->wheel, slots, config->wheel_slots, config->tick_shift,
+                                          config->get_us(config->clock_ctx));
+            for (uint8_t bus = 0; bus < config->bus_count; bus++) 
+            {
+                (void) isotp_frame_ring_init(&shard->rx_rings[bus], &frames[bus * config->ring_size], config->ring_size);
+            }
+        }
+    }
+
+    return shard;
+}
+
+/* hand queued frames of one bus to their links */
+static uint32_t isotp_engine_shard_receive(IsoTpEngineShard *shard, uint8_t bus, IsoTpClock *clock) 
+{
+    uint32_t frames = 0;
+    IsoTpFrameRing *ring = &shard->rx_rings[bus];
+    const IsoTpCanFrame *frame = NULL;
+
+    while (frames < ISO_TP_ENGINE_BATCH && NULL != (frame = isotp_frame_ring_front(ring))) 
+    {
+        IsoTpLink *link = isotp_dispatcher_find(&shard->dispatcher, bus, frame->arbitration_id);
+
+        if (link != NULL) 
+        {
+            (void) isotp_on_can_message_at(link, frame->data, frame->len, clock);
+        }
+        isotp_frame_ring_release(ring);
+        frames += 1;
+    }
+
+    return frames;
+}
+
+static void* isotp_engine_shard_main(void *arg) 
+{
+    IsoTpEngineShard *shard = (IsoTpEngineShard *)arg;
+    IsoTpEngine *engine = shard->engine;
+
+    while (ISOTP_LOAD_ACQUIRE(&shard->running)) 
+    {
+        uint32_t work = 0;
+        IsoTpClock clock = { 0, 0 };
+
+        for (uint8_t bus = 0; bus < engine->bus_count; bus++) 
+        {
+            work += isotp_engine_shard_receive(shard, bus, &clock);
+        }
+        work += isotp_submit_queue_drain(&shard->submit_queue, ISO_TP_ENGINE_BATCH);
+        work += isotp_timer_wheel_advance(&shard->wheel, engine->get_us(engine->clock_ctx));
+
+        /* busy-polls, see ISO_TP_ENGINE_IDLE_US */
+        if (0 == work) 
+        {
+#if ISO_TP_ENGINE_IDLE_US > 0
+            const struct timespec idle = { 0, ISO_TP_ENGINE_IDLE_US * 1000L };
+            (void) nanosleep(&idle, NULL);
+#else
+            (void) sched_yield();
+#endif
+        }
+    }
+
+    return NULL;
+}
+
+static int isotp_engine_shard_start(IsoTpEngineShard *shard) 
+{
+    int ret = ISOTP_RET_ERROR;
+    pthread_attr_t attr;
+
+    if (0 == pthread_attr_init(&attr)) 
+    {
+#ifdef __linux__
+        if (shard->cpu >= 0) 
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(shard->cpu, &cpus);
+            (void) pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+        }
+#endif
+        ISOTP_STORE_RELEASE(&shard->running, 1);
+        if (0 == pthread_create(&shard->thread, &attr, isotp_engine_shard_main, shard)) 
+        {
+            ret = ISOTP_RET_OK;
+
+        } else {
+
+            shard->running = 0;
+        }
+        (void) pthread_attr_destroy(&attr);
+    }
+
+    return ret;
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+IsoTpEngine* isotp_engine_create(const IsoTpEngineConfig *config) 
+{
+    assert( config != NULL );
+
+    IsoTpEngine *engine = NULL;
+
+    if (0 == config->shard_count || 0 == config->bus_count || NULL == config->get_us ||
+        !isotp_engine_is_pow2(config->links_per_shard) || !isotp_engine_is_pow2(config->ring_size) ||
+        !isotp_engine_is_pow2(config->wheel_slots)) 
+    {
+        engine = NULL;
+
+    } else if (NULL != (engine = calloc(1, sizeof(IsoTpEngine)))) {
+
+        engine->shard_count = config->shard_count;
+        engine->bus_count = config->bus_count;
+        engine->get_us = config->get_us;
+        engine->clock_ctx = config->clock_ctx;
+        engine->shards = calloc(config->shard_count, sizeof(IsoTpEngineShard *));
+
+        for (uint16_t index = 0; engine->shards != NULL && index < config->shard_count; index++) 
+        {
+            engine->shards[index] = isotp_engine_shard_create(engine, config, index);
+            if (NULL == engine->shards[index]) 
+            {
+                isotp_engine_destroy(engine);
+                engine = NULL;
+                break;
+            }
+        }
+
+        if (engine != NULL && NULL == engine->shards) 
+        {
+            free(engine);
+            engine = NULL;
+        }
+    }
+
+    return engine;
+}
+
+void isotp_engine_destroy(IsoTpEngine *engine) 
+{
+    if (engine != NULL) 
+    {
+        isotp_engine_stop(engine);
+        for (uint16_t index = 0; engine->shards != NULL && index < engine->shard_count; index++) 
+        {
+            isotp_engine_shard_free(engine->shards[index]);
+        }
+        free(engine->shards);
+        free(engine);
+    }
+}
+
+uint16_t isotp_engine_shard_of(const IsoTpEngine *engine, uint8_t bus, uint32_t rx_id) 
+{
+    assert( engine != NULL );
+
+    /* fibonacci hash, scaled to the shard count by its high bits; the dispatcher
+     * of the shard indexes with a different hash, so its table stays evenly filled */
+    const uint32_t h = (rx_id ^ ((uint32_t)bus << 24)) * 0x9E3779B9u;
+
+    return (uint16_t)(((uint64_t)h * engine->shard_count) >> 32);
+}
+
+int isotp_engine_register(IsoTpEngine *engine, uint8_t bus, uint32_t rx_id, IsoTpLink *link) 
+{
+    assert( engine != NULL );
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (engine->started) 
+    {
+        ret = ISOTP_RET_INPROGRESS;
+
+    } else if (bus >= engine->bus_count) {
+
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        IsoTpEngineShard *shard = engine->shards[isotp_engine_shard_of(engine, bus, rx_id)];
+
+        ret = isotp_dispatcher_register(&shard->dispatcher, bus, rx_id, link);
+        if (ISOTP_RET_OK == ret) 
+        {
+            isotp_timer_wheel_add_link(&shard->wheel, link);
+        }
+    }
+
+    return ret;
+}
+
+int isotp_engine_start(IsoTpEngine *engine) 
+{
+    assert( engine != NULL );
+
+    int ret = ISOTP_RET_OK;
+
+    if (!engine->started) 
+    {
+        engine->started = 1;
+        for (uint16_t index = 0; ISOTP_RET_OK == ret && index < engine->shard_count; index++) 
+        {
+            ret = isotp_engine_shard_start(engine->shards[index]);
+        }
+
+        if (ISOTP_RET_OK != ret) 
+        {
+            isotp_engine_stop(engine);
+        }
+    }
+
+    return ret;
+}
+
+void isotp_engine_stop(IsoTpEngine *engine) 
+{
+    assert( engine != NULL );
+
+    if (engine->started) 
+    {
+        for (uint16_t index = 0; index < engine->shard_count; index++) 
+        {
+            if (engine->shards[index]->running) 
+            {
+                ISOTP_STORE_RELEASE(&engine->shards[index]->running, 0);
+                (void) pthread_join(engine->shards[index]->thread, NULL);
+            }
+        }
+        engine->started = 0;
+    }
+
+    return;
+}
+
+int isotp_engine_on_can_message(IsoTpEngine *engine, uint8_t bus, uint32_t id, const uint8_t *data, uint8_t len) 
+{
+    assert( engine != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (bus < engine->bus_count) 
+    {
+        IsoTpEngineShard *shard = engine->shards[isotp_engine_shard_of(engine, bus, id)];
+        ret = isotp_frame_ring_push(&shard->rx_rings[bus], id, data, len);
+    }
+
+    return ret;
+}
+
+void isotp_engine_submit(IsoTpEngine *engine, IsoTpSubmission *submission, IsoTpLink *link,
+                         uint32_t id, const uint8_t payload[], uint32_t size) 
+{
+    assert( engine != NULL );
+    assert( link != NULL );
+    assert( link->timer_wheel != NULL );
+
+    /* registered links sit in the timer wheel of their shard */
+    IsoTpEngineShard *shard = (IsoTpEngineShard *)((uint8_t *)link->timer_wheel - offsetof(IsoTpEngineShard, wheel));
+
+    isotp_submit(&shard->submit_queue, submission, link, id, payload, size);
+}
@@ -0,0 +1,142 @@
+#ifndef __ISOTP_ENGINE_H__
+#define __ISOTP_ENGINE_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+#include "isotp_dispatcher.h"
+#include "isotp_timer.h"
+#include "isotp_ring.h"
+#include "isotp_submit.h"
+
+/* Shard threads busy-poll their rings, submission queue and timer wheel by design, the engine is
+ * meant for shards pinned to CPUs of their own. With nothing to do a shard yields the CPU, or sleeps
+ * this many microseconds if set above 0, which adds up to that much latency to the next frame.
+ */
+#ifndef ISO_TP_ENGINE_IDLE_US
+#define ISO_TP_ENGINE_IDLE_US               ( 0 )
+#endif
+
+/* Frames and submissions a shard takes per source before it moves on to the next one.
+ */
+#ifndef ISO_TP_ENGINE_BATCH
+#define ISO_TP_ENGINE_BATCH                 ( 64 )
+#endif
+
+/**
+ * @brief Sizes of an @code IsoTpEngine @endcode, see @link isotp_engine_create @endlink.
+ */
+typedef struct IsoTpEngineConfig {
+    uint16_t                    shard_count;      /* worker threads */
+    uint8_t                     bus_count;        /* buses 0 .. bus_count - 1 */
+    uint32_t                    links_per_shard;  /* dispatcher table size, power of two */
+    uint32_t                    ring_size;        /* frames queued per bus and shard, power of two */
+    uint32_t                    wheel_slots;      /* timer wheel slots per shard, power of two */
+    uint8_t                     tick_shift;       /* timer wheel tick of 1 << tick_shift microseconds */
+    const int*                  cpus;             /* CPU of each shard, -1 or NULL leaves it to the OS */
+    uint32_t                    (*get_us)(void *ctx); /* clock of the timer wheels */
+    void*                       clock_ctx;
+} IsoTpEngineConfig;
+
+/**
+ * @brief One worker thread and the links it owns.
+ *
+ * Only the shard thread touches the dispatcher, the timer wheel and the links; other threads
+ * reach it through the frame rings, one per bus so each keeps a single producer, and through
+ * the submission queue.
+ */
+typedef struct IsoTpEngineShard {
+    /* sends from any thread, first so its cache line padding lines up */
+    IsoTpSubmitQueue            submit_queue;
+    /* owned by the shard thread */
+    IsoTpDispatcher             dispatcher;
+    IsoTpTimerWheel             wheel;
+    IsoTpFrameRing*             rx_rings;         /* indexed by bus */
+    /* control */
+    uint32_t                    running;
+    int                         cpu;
+    pthread_t                   thread;
+    struct IsoTpEngine*         engine;
+} IsoTpEngineShard;
+
+/**
+ * @brief Links of many buses spread over worker threads, see @link isotp_engine_create @endlink.
+ */
+typedef struct IsoTpEngine {
+    IsoTpEngineShard**          shards;           /* each on its own cache lines */
+    uint16_t                    shard_count;
+    uint8_t                     bus_count;
+    uint8_t                     started;
+    uint32_t                    (*get_us)(void *ctx);
+    void*                       clock_ctx;
+} IsoTpEngine;
+
+/**
+ * @brief Allocates an engine of @p config->shard_count worker threads.
+ *
+ * Links are assigned to a shard by their (bus, receive CAN ID) and are then driven by that
+ * shard's thread only: received frames, timeouts and sends. Link callbacks run on it too.
+ * Shards share nothing but the frame rings and submission queues, so throughput grows
+ * with the number of cores as long as the links are spread evenly.
+ *
+ * @return The engine, or NULL if the config is invalid or memory ran out.
+ */
+IsoTpEngine* isotp_engine_create(const IsoTpEngineConfig *config);
+
+/**
+ * @brief Stops the engine if running and frees it. Links are not freed.
+ */
+void isotp_engine_destroy(IsoTpEngine *engine);
+
+/**
+ * @brief Returns the shard which owns the link of a (bus, receive CAN ID) pair.
+ */
+uint16_t isotp_engine_shard_of(const IsoTpEngine *engine, uint8_t bus, uint32_t rx_id);
+
+/**
+ * @brief Hands a link to the shard of its (bus, receive CAN ID), before @link isotp_engine_start @endlink.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_INPROGRESS @endcode if the engine is running
+ *  - @code ISOTP_RET_ERROR @endcode if the bus is unknown, see also @link isotp_dispatcher_register @endlink
+ */
+int isotp_engine_register(IsoTpEngine *engine, uint8_t bus, uint32_t rx_id, IsoTpLink *link);
+
+/**
+ * @brief Starts the shard threads, pinned to their CPU if one is configured.
+ * @return ISOTP_RET_OK, or ISOTP_RET_ERROR if a thread could not be created; the engine is then stopped.
+ */
+int isotp_engine_start(IsoTpEngine *engine);
+
+/**
+ * @brief Stops and joins the shard threads. Links keep their state and may be used directly afterwards.
+ */
+void isotp_engine_stop(IsoTpEngine *engine);
+
+/**
+ * @brief Passes a received frame to the shard owning its link.
+ *
+ * Each bus must be fed from a single context, e.g. its RX thread, which never blocks here.
+ *
+ * @return ISOTP_RET_OK, ISOTP_RET_OVERFLOW if the frame ring of the shard is full,
+ *         ISOTP_RET_LENGTH or ISOTP_RET_ERROR if the frame or the bus is invalid.
+ */
+int isotp_engine_on_can_message(IsoTpEngine *engine, uint8_t bus, uint32_t id, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Sends on a registered link, from any thread; see @link isotp_submit @endlink.
+ */
+void isotp_engine_submit(IsoTpEngine *engine, IsoTpSubmission *submission, IsoTpLink *link,
+                         uint32_t id, const uint8_t payload[], uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_ENGINE_H__
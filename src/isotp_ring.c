@@ -0,0 +1,140 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "isotp_ring.h"
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+int isotp_frame_ring_init(IsoTpFrameRing *ring, IsoTpCanFrame *frames, uint32_t capacity) 
+{
+    assert( ring != NULL );
+    assert( frames != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    /* capacity must be a power of two */
+    if (capacity < 2 || 0 != (capacity & (capacity - 1))) 
+    {
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        (void) memset(ring, 0, sizeof(IsoTpFrameRing));
+        ring->frames = frames;
+        ring->mask = capacity - 1;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_frame_ring_push(IsoTpFrameRing *ring, uint32_t arbitration_id, const uint8_t *data, uint8_t len) 
+{
+    assert( ring != NULL );
+    assert( data != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+    const uint32_t tail = ring->tail;
+
+    if (len > ISO_TP_MAX_FRAME_SIZE) 
+    {
+        ret = ISOTP_RET_LENGTH;
+
+    } else {
+
+        /* only look at the consumer's index when the cached one says full */
+        if (tail - ring->head_cache > ring->mask) 
+        {
+            ring->head_cache = ISOTP_LOAD_ACQUIRE(&ring->head);
+        }
+
+        if (tail - ring->head_cache > ring->mask) 
+        {
+            ret = ISOTP_RET_OVERFLOW;
+
+        } else {
+
+            IsoTpCanFrame *frame = &ring->frames[tail & ring->mask];
+            frame->arbitration_id = arbitration_id;
+            frame->len = len;
+            (void) memcpy(frame->data, data, len);
+
+            /* publish the frame */
+            ISOTP_STORE_RELEASE(&ring->tail, tail + 1);
+
+            ret = ISOTP_RET_OK;
+        }
+    }
+
+    return ret;
+}
+
+const IsoTpCanFrame* isotp_frame_ring_front(IsoTpFrameRing *ring) 
+{
+    assert( ring != NULL );
+
+    const IsoTpCanFrame *frame = NULL;
+    const uint32_t head = ring->head;
+
+    /* only look at the producer's index when the cached one says empty */
+    if (head == ring->tail_cache) 
+    {
+        ring->tail_cache = ISOTP_LOAD_ACQUIRE(&ring->tail);
+    }
+
+    if (head != ring->tail_cache) 
+    {
+        frame = &ring->frames[head & ring->mask];
+    }
+
+    return frame;
+}
+
+void isotp_frame_ring_release(IsoTpFrameRing *ring) 
+{
+    assert( ring != NULL );
+    assert( ring->head != ring->tail_cache );
+
+    /* hand the slot back to the producer */
+    ISOTP_STORE_RELEASE(&ring->head, ring->head + 1);
+}
+
+uint32_t isotp_frame_ring_drain(IsoTpFrameRing *ring, IsoTpLink *link, uint32_t max_frames) 
+{
+    assert( ring != NULL );
+    assert( link != NULL );
+
+    uint32_t frames = 0;
+
+    while (frames < max_frames && NULL != isotp_frame_ring_front(ring)) 
+    {
+        const uint32_t head = ring->head;
+        const uint32_t slot = head & ring->mask;
+        uint32_t count = ring->tail_cache - head;
+
+        /* the frames up to the end of the storage are one batch, the rest follows from the start */
+        if (count > ring->mask + 1 - slot) 
+        {
+            count = ring->mask + 1 - slot;
+        }
+        if (count > max_frames - frames) 
+        {
+            count = max_frames - frames;
+        }
+        if (count > UINT16_MAX) 
+        {
+            count = UINT16_MAX;
+        }
+
+        (void) isotp_on_can_messages(link, &ring->frames[slot], (uint16_t)count);
+
+        /* hand the slots back to the producer */
+        ISOTP_STORE_RELEASE(&ring->head, head + count);
+        frames += count;
+    }
+
+    return frames;
+}
@@ -0,0 +1,81 @@
+#ifndef __ISOTP_RING_H__
+#define __ISOTP_RING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/**
+ * @brief Lock-free single producer, single consumer ring of raw CAN frames.
+ *
+ * The receive context (an ISR or RX thread) pushes frames, the protocol context drains them
+ * into its links, so neither takes a lock. Each index is written by one side only and sits on
+ * its own cache line next to that side's cached copy of the other index, so the sides only
+ * touch each other's line when the cached copy runs out.
+ */
+typedef struct IsoTpFrameRing {
+    /* set up by init, read only afterwards */
+    IsoTpCanFrame*              frames;
+    uint32_t                    mask;             /* capacity - 1 */
+    uint8_t                     pad_0[ISOTP_CACHE_LINE_SIZE - sizeof(IsoTpCanFrame*) - sizeof(uint32_t)];
+    /* producer side */
+    uint32_t                    tail;             /* next slot to write */
+    uint32_t                    head_cache;       /* producer's view of head */
+    uint8_t                     pad_1[ISOTP_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+    /* consumer side */
+    uint32_t                    head;             /* next slot to read */
+    uint32_t                    tail_cache;       /* consumer's view of tail */
+    uint8_t                     pad_2[ISOTP_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+} IsoTpFrameRing;
+
+/**
+ * @brief Initialises a frame ring on top of application provided storage.
+ *
+ * @param ring The @code IsoTpFrameRing @endcode instance.
+ * @param frames The frame storage.
+ * @param capacity The number of frames; must be a power of two.
+ * @return ISOTP_RET_OK or ISOTP_RET_ERROR if the capacity is invalid.
+ */
+int isotp_frame_ring_init(IsoTpFrameRing *ring, IsoTpCanFrame *frames, uint32_t capacity);
+
+/**
+ * @brief Adds a frame, from the producer context only.
+ *
+ * @return
+ *  - @link ISOTP_RET_OK @endlink
+ *  - @link ISOTP_RET_OVERFLOW @endlink if the ring is full, the frame is dropped
+ *  - @link ISOTP_RET_LENGTH @endlink if len exceeds ISO_TP_MAX_FRAME_SIZE
+ */
+int isotp_frame_ring_push(IsoTpFrameRing *ring, uint32_t arbitration_id, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Returns the oldest frame without removing it, from the consumer context only.
+ * @return The frame, valid until @link isotp_frame_ring_release @endlink, or NULL if the ring is empty.
+ */
+const IsoTpCanFrame* isotp_frame_ring_front(IsoTpFrameRing *ring);
+
+/**
+ * @brief Removes the frame returned by @link isotp_frame_ring_front @endlink.
+ */
+void isotp_frame_ring_release(IsoTpFrameRing *ring);
+
+/**
+ * @brief Hands up to @p max_frames queued frames to a link, from the consumer context only.
+ *
+ * The frames are processed in place by @link isotp_on_can_messages @endlink, so frames of other IDs
+ * are skipped and the link's clock and timer are handled once per batch; a drain which wraps around
+ * the end of the ring hands over two batches.
+ *
+ * @return The number of frames taken from the ring.
+ */
+uint32_t isotp_frame_ring_drain(IsoTpFrameRing *ring, IsoTpLink *link, uint32_t max_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_RING_H__
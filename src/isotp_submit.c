@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "isotp_submit.h"
+
+#if !defined(ISOTP_EXCHANGE_PTR) || !defined(ISOTP_LOAD_ACQUIRE_PTR) || !defined(ISOTP_STORE_RELEASE_PTR)
+#error "isotp_submit.c needs ISOTP_EXCHANGE_PTR, ISOTP_LOAD_ACQUIRE_PTR and ISOTP_STORE_RELEASE_PTR"
+#endif
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+/* append a submission, from any thread */
+static void isotp_submit_push(IsoTpSubmitQueue *queue, IsoTpSubmission *submission) 
+{
+    IsoTpSubmission *prev = NULL;
+
+    submission->next = NULL;
+
+    /* claim the tail; until prev->next is set below the consumer sees the chain end at prev */
+    prev = ISOTP_EXCHANGE_PTR(&queue->tail, submission);
+    ISOTP_STORE_RELEASE_PTR(&prev->next, submission);
+}
+
+/* take the oldest submission, from the consumer thread only */
+static IsoTpSubmission* isotp_submit_pop(IsoTpSubmitQueue *queue) 
+{
+    IsoTpSubmission *taken = NULL;
+    IsoTpSubmission *head = queue->head;
+    IsoTpSubmission *next = ISOTP_LOAD_ACQUIRE_PTR(&head->next);
+
+    /* step over the stub */
+    if (head == &queue->stub && NULL != next) 
+    {
+        queue->head = next;
+        head = next;
+        next = ISOTP_LOAD_ACQUIRE_PTR(&head->next);
+    }
+
+    if (head == &queue->stub) 
+    {
+        /* empty */
+
+    } else if (NULL != next) {
+
+        queue->head = next;
+        taken = head;
+
+    } else if (head == ISOTP_LOAD_ACQUIRE_PTR(&queue->tail)) {
+
+        /* head is the last submission, put the stub behind it so it can be taken */
+        isotp_submit_push(queue, &queue->stub);
+
+        next = ISOTP_LOAD_ACQUIRE_PTR(&head->next);
+        if (NULL != next) 
+        {
+            queue->head = next;
+            taken = head;
+        }
+    }
+
+    /* otherwise a producer swapped the tail but has not linked its submission yet,
+     * it is taken by the next drain */
+
+    return taken;
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+void isotp_submit_queue_init(IsoTpSubmitQueue *queue) 
+{
+    assert( queue != NULL );
+
+    (void) memset(queue, 0, sizeof(IsoTpSubmitQueue));
+    queue->tail = &queue->stub;
+    queue->head = &queue->stub;
+}
+
+void isotp_submit(IsoTpSubmitQueue *queue, IsoTpSubmission *submission, IsoTpLink *link,
+                  uint32_t id, const uint8_t payload[], uint32_t size) 
+{
+    assert( queue != NULL );
+    assert( submission != NULL );
+    assert( link != NULL );
+    assert( payload != NULL );
+
+    submission->link = link;
+    submission->request.arbitration_id = id;
+    submission->request.payload = payload;
+    submission->request.size = size;
+    submission->request.completion = &submission->completion;
+    submission->completion.status = ISOTP_RET_OK;
+    submission->completion.result = ISOTP_PROTOCOL_RESULT_OK;
+    submission->completion.done = 0;
+
+    /* the exchange in push publishes the fields above */
+    isotp_submit_push(queue, submission);
+}
+
+int isotp_submission_done(const IsoTpSubmission *submission) 
+{
+    assert( submission != NULL );
+
+    return 0 != ISOTP_LOAD_ACQUIRE(&submission->completion.done);
+}
+
+uint32_t isotp_submit_queue_drain(IsoTpSubmitQueue *queue, uint32_t max_submissions) 
+{
+    assert( queue != NULL );
+
+    uint32_t submissions = 0;
+    IsoTpSubmission *submission = NULL;
+
+    while (submissions < max_submissions && NULL != (submission = isotp_submit_pop(queue))) 
+    {
+        /* the outcome, refusal included, is reported through the completion */
+        (void) isotp_send_request(submission->link, &submission->request);
+        submissions += 1;
+    }
+
+    return submissions;
+}
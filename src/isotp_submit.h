@@ -0,0 +1,89 @@
+#ifndef __ISOTP_SUBMIT_H__
+#define __ISOTP_SUBMIT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/**
+ * @brief A send handed to the protocol thread through an @code IsoTpSubmitQueue @endcode.
+ *
+ * Filled by @link isotp_submit @endlink. The submission and its payload belong to the library
+ * until @link isotp_submission_done @endlink returns non-zero; the submitting thread may then
+ * read the completion and reuse both.
+ */
+typedef struct IsoTpSubmission {
+    struct IsoTpSubmission*     next;             /* queue link */
+    IsoTpLink*                  link;
+    IsoTpTxRequest              request;
+    IsoTpCompletion             completion;
+} IsoTpSubmission;
+
+/**
+ * @brief Lock-free multi producer, single consumer queue of sends.
+ *
+ * Any thread submits without blocking: a submission costs one atomic exchange, whatever the
+ * number of producers. One protocol thread owns every @code IsoTpLink @endcode and drains the
+ * queue into them, so the links themselves need no lock. The queue is intrusive, submissions
+ * are chained through their own next field and no memory is allocated.
+ */
+typedef struct IsoTpSubmitQueue {
+    /* producer side, swapped by every submitting thread */
+    IsoTpSubmission*            tail;             /* newest submission */
+    uint8_t                     pad_0[ISOTP_CACHE_LINE_SIZE - sizeof(IsoTpSubmission*)];
+    /* consumer side */
+    IsoTpSubmission*            head;             /* oldest submission, or the stub */
+    IsoTpSubmission             stub;             /* keeps the chain non empty */
+} IsoTpSubmitQueue;
+
+/**
+ * @brief Initialises an empty submission queue.
+ */
+void isotp_submit_queue_init(IsoTpSubmitQueue *queue);
+
+/**
+ * @brief Queues a send of @p payload on @p link, from any thread.
+ *
+ * Never blocks and never fails; the send is started by the next
+ * @link isotp_submit_queue_drain @endlink of the protocol thread.
+ *
+ * @param queue The queue drained by the thread owning @p link.
+ * @param submission Caller storage for the request, see @code IsoTpSubmission @endcode.
+ * @param link The @code IsoTpLink @endcode instance to send on.
+ * @param id The arbitration id, see @link isotp_send_with_id @endlink.
+ * @param payload The payload, not copied.
+ * @param size The size of the payload.
+ */
+void isotp_submit(IsoTpSubmitQueue *queue, IsoTpSubmission *submission, IsoTpLink *link,
+                  uint32_t id, const uint8_t payload[], uint32_t size);
+
+/**
+ * @brief Tells the submitting thread whether a submission is finished.
+ *
+ * @return Non-zero once submission->completion holds the outcome: status is ISOTP_RET_OK and
+ *         result the N_USData.confirm result, or status is the error returned by
+ *         @link isotp_send_request @endlink, e.g. ISOTP_RET_OVERFLOW when the transmit queue
+ *         of the link is full.
+ */
+int isotp_submission_done(const IsoTpSubmission *submission);
+
+/**
+ * @brief Starts or queues up to @p max_submissions waiting sends on their links,
+ * from the protocol thread only.
+ *
+ * Each submission goes through @link isotp_send_request @endlink, so a link busy with another
+ * message needs a transmit queue, see @link isotp_set_tx_queue @endlink.
+ *
+ * @return The number of submissions taken from the queue.
+ */
+uint32_t isotp_submit_queue_drain(IsoTpSubmitQueue *queue, uint32_t max_submissions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_SUBMIT_H__
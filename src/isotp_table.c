@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "isotp_table.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ISOTP_TABLE_SSE2 1
+#endif
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+/* expired links among the 32 starting at deadline_us / armed, as !IsoTpTimeAfter(deadline, now) */
+static uint32_t isotp_link_table_word(const uint32_t *deadline_us, const uint32_t *armed, uint32_t now_us) 
+{
+    uint32_t bits = 0;
+
+#if defined(__AVX2__)
+    const __m256i now = _mm256_set1_epi32((int32_t)now_us);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (uint32_t lane = 0; lane < ISOTP_LINK_TABLE_WORD_BITS; lane += 8) 
+    {
+        const __m256i deadline = _mm256_loadu_si256((const __m256i *)&deadline_us[lane]);
+        const __m256i mask = _mm256_loadu_si256((const __m256i *)&armed[lane]);
+        /* pending while (int32_t)(now - deadline) < 0 */
+        const __m256i pending = _mm256_cmpgt_epi32(zero, _mm256_sub_epi32(now, deadline));
+
+        bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(pending, mask))) << lane;
+    }
+#elif defined(ISOTP_TABLE_SSE2)
+    const __m128i now = _mm_set1_epi32((int32_t)now_us);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (uint32_t lane = 0; lane < ISOTP_LINK_TABLE_WORD_BITS; lane += 4) 
+    {
+        const __m128i deadline = _mm_loadu_si128((const __m128i *)&deadline_us[lane]);
+        const __m128i mask = _mm_loadu_si128((const __m128i *)&armed[lane]);
+        /* pending while (int32_t)(now - deadline) < 0 */
+        const __m128i pending = _mm_cmplt_epi32(_mm_sub_epi32(now, deadline), zero);
+
+        bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(pending, mask))) << lane;
+    }
+#else
+    for (uint32_t lane = 0; lane < ISOTP_LINK_TABLE_WORD_BITS; lane++) 
+    {
+        if (armed[lane] && !IsoTpTimeAfter(deadline_us[lane], now_us)) 
+        {
+            bits |= (uint32_t)1 << lane;
+        }
+    }
+#endif
+
+    return bits;
+}
+
+/* index of the lowest set bit, bits must not be 0 */
+static uint32_t isotp_link_table_lowest(uint32_t bits) 
+{
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_ctz(bits);
+#else
+    uint32_t index = 0;
+
+    while (0 == (bits & 1)) 
+    {
+        bits >>= 1;
+        index += 1;
+    }
+
+    return index;
+#endif
+}
+
+static uint32_t isotp_link_table_popcount(uint32_t bits) 
+{
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_popcount(bits);
+#else
+    uint32_t count = 0;
+
+    for (; bits != 0; bits &= bits - 1) 
+    {
+        count += 1;
+    }
+
+    return count;
+#endif
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+int isotp_link_table_init(IsoTpLinkTable *table, IsoTpLink *links[], uint32_t deadline_us[], uint32_t armed[], uint32_t capacity) 
+{
+    assert( table != NULL );
+    assert( links != NULL );
+    assert( deadline_us != NULL );
+    assert( armed != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (0 == capacity || 0 != (capacity % ISOTP_LINK_TABLE_WORD_BITS)) 
+    {
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        /* unused slots are never armed, so the scan needs no tail handling */
+        (void) memset(links, 0, capacity * sizeof(IsoTpLink *));
+        (void) memset(deadline_us, 0, capacity * sizeof(uint32_t));
+        (void) memset(armed, 0, capacity * sizeof(uint32_t));
+        table->links = links;
+        table->deadline_us = deadline_us;
+        table->armed = armed;
+        table->capacity = capacity;
+        table->count = 0;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+int isotp_link_table_add(IsoTpLinkTable *table, IsoTpLink *link) 
+{
+    assert( table != NULL );
+    assert( link != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    if (table->count >= table->capacity) 
+    {
+        ret = ISOTP_RET_OVERFLOW;
+
+    } else {
+
+        ret = (int)table->count;
+        table->links[table->count] = link;
+        table->count += 1;
+        isotp_link_table_sync(table, (uint32_t)ret);
+    }
+
+    return ret;
+}
+
+void isotp_link_table_sync(IsoTpLinkTable *table, uint32_t index) 
+{
+    assert( table != NULL );
+    assert( index < table->count );
+
+    uint32_t deadline_us;
+
+    if (ISOTP_RET_OK == isotp_next_deadline(table->links[index], &deadline_us)) 
+    {
+        table->deadline_us[index] = deadline_us;
+        table->armed[index] = UINT32_MAX;
+
+    } else {
+
+        table->armed[index] = 0;
+    }
+}
+
+uint32_t isotp_link_table_scan(const IsoTpLinkTable *table, uint32_t now_us, uint32_t expired[]) 
+{
+    assert( table != NULL );
+    assert( expired != NULL );
+
+    uint32_t count = 0;
+
+    for (uint32_t base = 0; base < table->capacity; base += ISOTP_LINK_TABLE_WORD_BITS) 
+    {
+        const uint32_t bits = isotp_link_table_word(&table->deadline_us[base], &table->armed[base], now_us);
+
+        expired[base / ISOTP_LINK_TABLE_WORD_BITS] = bits;
+        count += isotp_link_table_popcount(bits);
+    }
+
+    return count;
+}
+
+uint32_t isotp_link_table_poll(IsoTpLinkTable *table, uint32_t now_us) 
+{
+    assert( table != NULL );
+
+    uint32_t polled = 0;
+
+    /* only words holding links are scanned */
+    for (uint32_t base = 0; base < table->count; base += ISOTP_LINK_TABLE_WORD_BITS) 
+    {
+        uint32_t bits = isotp_link_table_word(&table->deadline_us[base], &table->armed[base], now_us);
+
+        for (; bits != 0; bits &= bits - 1) 
+        {
+            const uint32_t index = base + isotp_link_table_lowest(bits);
+
+            isotp_poll(table->links[index]);
+            isotp_link_table_sync(table, index);
+            polled += 1;
+        }
+    }
+
+    return polled;
+}
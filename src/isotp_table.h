@@ -0,0 +1,77 @@
+#ifndef __ISOTP_TABLE_H__
+#define __ISOTP_TABLE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/* Links per word of the expiry bitmask, table capacities are a multiple of it.
+ */
+#define ISOTP_LINK_TABLE_WORD_BITS          ( 32 )
+
+/**
+ * @brief Structure-of-arrays view of many links, for scanning their timeouts.
+ *
+ * The next deadline of every link (see @link isotp_next_deadline @endlink) and whether it has
+ * one are kept in parallel arrays, so a scan reads 8 bytes per link instead of the link itself.
+ * The scan compares 8 links per instruction with AVX2, 4 with SSE2, and one at a time elsewhere.
+ *
+ * A slot is refreshed by @link isotp_link_table_sync @endlink; call it after handing a frame to
+ * the link or sending on it. Links polled by @link isotp_link_table_poll @endlink are refreshed
+ * by the table.
+ */
+typedef struct IsoTpLinkTable {
+    IsoTpLink**                 links;
+    uint32_t*                   deadline_us;      /* next deadline of each link */
+    uint32_t*                   armed;            /* all ones if the link has a deadline, else 0 */
+    uint32_t                    capacity;
+    uint32_t                    count;
+} IsoTpLinkTable;
+
+/**
+ * @brief Initialises an empty link table on top of application provided arrays.
+ *
+ * @param table The @code IsoTpLinkTable @endcode instance.
+ * @param links, deadline_us, armed The arrays, each of @p capacity elements.
+ * @param capacity A non zero multiple of ISOTP_LINK_TABLE_WORD_BITS.
+ * @return ISOTP_RET_OK or ISOTP_RET_ERROR if the capacity is invalid.
+ */
+int isotp_link_table_init(IsoTpLinkTable *table, IsoTpLink *links[], uint32_t deadline_us[], uint32_t armed[], uint32_t capacity);
+
+/**
+ * @brief Appends a link.
+ * @return The index of the link in the table, or ISOTP_RET_OVERFLOW if the table is full.
+ */
+int isotp_link_table_add(IsoTpLinkTable *table, IsoTpLink *link);
+
+/**
+ * @brief Copies the next deadline of the link at @p index into the table.
+ */
+void isotp_link_table_sync(IsoTpLinkTable *table, uint32_t index);
+
+/**
+ * @brief Finds the links whose deadline has passed.
+ *
+ * @param table The @code IsoTpLinkTable @endcode instance.
+ * @param now_us The current time of the link clock.
+ * @param expired Bitmask of capacity / ISOTP_LINK_TABLE_WORD_BITS words; bit i % 32 of
+ *                word i / 32 is set if link i needs isotp_poll.
+ * @return The number of links needing isotp_poll.
+ */
+uint32_t isotp_link_table_scan(const IsoTpLinkTable *table, uint32_t now_us, uint32_t expired[]);
+
+/**
+ * @brief Polls the links whose deadline has passed and refreshes their slots.
+ * @return The number of links polled.
+ */
+uint32_t isotp_link_table_poll(IsoTpLinkTable *table, uint32_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_TABLE_H__
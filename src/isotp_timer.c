@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "isotp_timer.h"
+
+///////////////////////////////////////////////////////
+///                 STATIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+/* ticks wrap together with the microsecond clock */
+static uint32_t isotp_timer_wheel_tick(const IsoTpTimerWheel *wheel, uint32_t time_us) 
+{
+    return time_us >> wheel->tick_shift;
+}
+
+static void isotp_timer_unlink(IsoTpTimer *timer) 
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) 
+    {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+///////////////////////////////////////////////////////
+///                 PUBLIC FUNCTIONS                ///
+///////////////////////////////////////////////////////
+
+int isotp_timer_wheel_init(IsoTpTimerWheel *wheel, IsoTpTimer **slots, uint32_t slot_count, uint8_t tick_shift, uint32_t now_us) 
+{
+    assert( wheel != NULL );
+    assert( slots != NULL );
+
+    int ret = ISOTP_RET_ERROR;
+
+    /* slot count must be a power of two */
+    if (slot_count < 2 || 0 != (slot_count & (slot_count - 1)) || tick_shift >= 32) 
+    {
+        ret = ISOTP_RET_ERROR;
+
+    } else {
+
+        for (uint32_t index = 0; index < slot_count; index++) 
+        {
+            slots[index] = NULL;
+        }
+        wheel->slots = slots;
+        wheel->mask = slot_count - 1;
+        wheel->tick_shift = tick_shift;
+        wheel->tick = isotp_timer_wheel_tick(wheel, now_us);
+        wheel->count = 0;
+
+        ret = ISOTP_RET_OK;
+    }
+
+    return ret;
+}
+
+void isotp_timer_wheel_add_link(IsoTpTimerWheel *wheel, IsoTpLink *link) 
+{
+    assert( wheel != NULL );
+    assert( link != NULL );
+
+    uint32_t deadline_us;
+
+    link->timer_wheel = wheel;
+    if (ISOTP_RET_OK == isotp_next_deadline(link, &deadline_us)) 
+    {
+        isotp_timer_wheel_schedule(wheel, &link->timer, deadline_us);
+    }
+}
+
+void isotp_timer_wheel_remove_link(IsoTpLink *link) 
+{
+    assert( link != NULL );
+
+    if (link->timer_wheel != NULL) 
+    {
+        isotp_timer_wheel_cancel(link->timer_wheel, &link->timer);
+        link->timer_wheel = NULL;
+    }
+}
+
+void isotp_timer_wheel_schedule(IsoTpTimerWheel *wheel, IsoTpTimer *timer, uint32_t deadline_us) 
+{
+    assert( wheel != NULL );
+    assert( timer != NULL );
+
+    uint32_t tick = isotp_timer_wheel_tick(wheel, deadline_us);
+    const uint32_t tick_mask = UINT32_MAX >> wheel->tick_shift;
+
+    isotp_timer_wheel_cancel(wheel, timer);
+
+    /* already expired, fire with the next advance */
+    if (((tick - wheel->tick) & tick_mask) > (tick_mask >> 1)) 
+    {
+        tick = wheel->tick;
+    }
+
+    IsoTpTimer **head = &wheel->slots[tick & wheel->mask];
+    timer->deadline_us = deadline_us;
+    timer->next = *head;
+    timer->pprev = head;
+    if (*head != NULL) 
+    {
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+
+    wheel->count += 1;
+}
+
+void isotp_timer_wheel_cancel(IsoTpTimerWheel *wheel, IsoTpTimer *timer) 
+{
+    assert( wheel != NULL );
+    assert( timer != NULL );
+
+    if (timer->pprev != NULL) 
+    {
+        isotp_timer_unlink(timer);
+        wheel->count -= 1;
+    }
+}
+
+uint32_t isotp_timer_wheel_advance(IsoTpTimerWheel *wheel, uint32_t now_us) 
+{
+    assert( wheel != NULL );
+
+    /* expired timers are kept apart from the slot lists, polling may re-arm any of them */
+    IsoTpTimer *expired[ISO_TP_TIMER_WHEEL_BATCH];
+    uint32_t count = 0;
+    uint32_t polled = 0;
+    uint32_t step = 0;
+    const uint32_t now_tick = isotp_timer_wheel_tick(wheel, now_us);
+    uint32_t ticks = (now_tick - wheel->tick) & (UINT32_MAX >> wheel->tick_shift);
+
+    /* every slot is visited at most once */
+    if (ticks > wheel->mask) 
+    {
+        ticks = wheel->mask;
+    }
+
+    /* collect expired timers first, polling re-arms them */
+    for (step = 0; step <= ticks && count < ISO_TP_TIMER_WHEEL_BATCH; step++) 
+    {
+        IsoTpTimer *timer = wheel->slots[(wheel->tick + step) & wheel->mask];
+
+        while (timer != NULL && count < ISO_TP_TIMER_WHEEL_BATCH) 
+        {
+            IsoTpTimer *next = timer->next;
+
+            if (!IsoTpTimeAfter(timer->deadline_us, now_us)) 
+            {
+                isotp_timer_wheel_cancel(wheel, timer);
+                expired[count] = timer;
+                count += 1;
+            }
+            timer = next;
+        }
+    }
+
+    /* a full batch resumes at the last slot visited with the next advance */
+    if (ISO_TP_TIMER_WHEEL_BATCH == count) 
+    {
+        wheel->tick = (wheel->tick + step - 1) & (UINT32_MAX >> wheel->tick_shift);
+
+    } else {
+
+        wheel->tick = now_tick;
+    }
+
+    for (uint32_t index = 0; index < count; index++) 
+    {
+        IsoTpTimer *timer = expired[index];
+
+        /* re-armed by a callback of a link polled before, it fires when due */
+        if (NULL == timer->pprev) 
+        {
+            isotp_poll((IsoTpLink *)((uint8_t *)timer - offsetof(IsoTpLink, timer)));
+            polled += 1;
+        }
+    }
+
+    return polled;
+}
@@ -0,0 +1,82 @@
+#ifndef __ISOTP_TIMER_H__
+#define __ISOTP_TIMER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "isotp.h"
+
+/* Links polled by one isotp_timer_wheel_advance at most, further expired ones wait for the next call.
+ */
+#ifndef ISO_TP_TIMER_WHEEL_BATCH
+#define ISO_TP_TIMER_WHEEL_BATCH            ( 64 )
+#endif
+
+/**
+ * @brief Hashed timing wheel over the microsecond clock of the links.
+ *
+ * Links added to a wheel arm their timer with @link isotp_next_deadline @endlink whenever a
+ * frame is sent or received, and disarm it when idle. Advancing the wheel only visits the slots
+ * of the elapsed ticks and polls the links whose deadline has passed, so the cost follows the
+ * number of running timers instead of the number of links.
+ */
+typedef struct IsoTpTimerWheel {
+    IsoTpTimer**                slots;
+    uint32_t                    mask;           /* slot count - 1 */
+    uint8_t                     tick_shift;     /* one tick is 1 << tick_shift microseconds */
+    uint32_t                    tick;           /* last tick advanced to */
+    uint32_t                    count;          /* armed timers */
+} IsoTpTimerWheel;
+
+/**
+ * @brief Initialises a timer wheel on top of application provided slots.
+ *
+ * @param wheel The @code IsoTpTimerWheel @endcode instance.
+ * @param slots The slot storage.
+ * @param slot_count The number of slots; must be a power of two. Deadlines further away
+ *                   than slot_count ticks share slots and are skipped until due.
+ * @param tick_shift The resolution, one tick is (1 << tick_shift) microseconds.
+ * @param now_us The current time of the link clock.
+ * @return ISOTP_RET_OK or ISOTP_RET_ERROR if the slot count is invalid.
+ */
+int isotp_timer_wheel_init(IsoTpTimerWheel *wheel, IsoTpTimer **slots, uint32_t slot_count, uint8_t tick_shift, uint32_t now_us);
+
+/**
+ * @brief Attaches a link to the wheel and arms its timer if it has a deadline.
+ */
+void isotp_timer_wheel_add_link(IsoTpTimerWheel *wheel, IsoTpLink *link);
+
+/**
+ * @brief Disarms the timer of a link and detaches it from its wheel.
+ */
+void isotp_timer_wheel_remove_link(IsoTpLink *link);
+
+/**
+ * @brief Arms a timer, or moves it when already armed.
+ */
+void isotp_timer_wheel_schedule(IsoTpTimerWheel *wheel, IsoTpTimer *timer, uint32_t deadline_us);
+
+/**
+ * @brief Disarms a timer, nothing happens when it is not armed.
+ */
+void isotp_timer_wheel_cancel(IsoTpTimerWheel *wheel, IsoTpTimer *timer);
+
+/**
+ * @brief Advances the wheel to @p now_us and calls @link isotp_poll @endlink for every link whose deadline has passed.
+ * The links re-arm themselves while polled. At most ISO_TP_TIMER_WHEEL_BATCH links are polled per call,
+ * the wheel then stays behind @p now_us and the next call goes on with the remaining ones.
+ *
+ * @param wheel The @code IsoTpTimerWheel @endcode instance.
+ * @param now_us The current time of the link clock.
+ * @return The number of links polled.
+ */
+uint32_t isotp_timer_wheel_advance(IsoTpTimerWheel *wheel, uint32_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ISOTP_TIMER_H__
@@ -18,6 +18,32 @@ int  isotp_user_send_can(const uint32_t arbitration_id,
 /* user implemented, get microsecond */
 uint32_t isotp_user_get_us(void);
 
+/* Use the functions above as transport of links which have no own ops.
+ * Set to 0 when every link gets its ops via isotp_set_user_ops, then the
+ * functions above need not be implemented.
+ */
+#ifndef ISO_TP_USER_DEFAULT_OPS
+#define ISO_TP_USER_DEFAULT_OPS             ( 1 )
+#endif
+
+/* per-link transport, every callback receives the context pointer given
+ * together with the ops. One ops table may be shared by all links of a bus.
+ */
+typedef struct IsoTpUserOps {
+    /* required, send can message. should return ISOTP_RET_OK when success */
+    int      (*send_can)(void *ctx, const uint32_t arbitration_id,
+                         const uint8_t* data, const uint8_t size);
+    /* required, get microsecond */
+    uint32_t (*get_us)(void *ctx);
+    /* optional, print debug message */
+    void     (*debug)(void *ctx, const char* message);
+} IsoTpUserOps;
+
+#if ISO_TP_USER_DEFAULT_OPS
+/* ops forwarding to the isotp_user_* functions */
+extern const IsoTpUserOps isotp_user_default_ops;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
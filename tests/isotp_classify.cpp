@@ -0,0 +1,141 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_classify.h"
+#include "isotp_null_bus.hpp"
+
+#define CLASSIFY_FRAMES     ( 100 )
+
+TEST_GROUP(ISOTP_CLASSIFY)
+{
+  IsoTpCanFrame g_frames[ CLASSIFY_FRAMES ];
+  uint8_t g_type[ CLASSIFY_FRAMES ];
+  uint8_t g_sn[ CLASSIFY_FRAMES ];
+  uint32_t g_length[ CLASSIFY_FRAMES ];
+  IsoTpFrameClasses g_classes;
+
+  void setup()
+  {
+    memset( g_frames, 0, sizeof( g_frames ) );
+    g_classes.type = g_type;
+    g_classes.sn = g_sn;
+    g_classes.length = g_length;
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+
+  void frame(uint32_t index, uint8_t len, uint8_t b0, uint8_t b1)
+  {
+    g_frames[index].len = len;
+    g_frames[index].data[0] = b0;
+    g_frames[index].data[1] = b1;
+  }
+};
+
+TEST(ISOTP_CLASSIFY, Types)
+{
+  frame(0, 8, 0x05, 0xAA);                    /* SF, 5 bytes */
+  frame(1, 64, 0x00, 0x30);                   /* CAN FD SF, escaped 48 bytes */
+  frame(2, 8, 0x1A, 0xBC);                    /* FF, 0xABC bytes */
+  frame(3, 8, 0x10, 0x00);                    /* FF, escaped 32 bit length */
+  g_frames[3].data[2] = 0x00; g_frames[3].data[3] = 0x01; g_frames[3].data[4] = 0x23; g_frames[3].data[5] = 0x45;
+  frame(4, 8, 0x2F, 0x00);                    /* CF, SN 15 */
+  frame(5, 3, 0x31, 0x08);                    /* FC WAIT, BS 8 */
+  frame(6, 8, 0x45, 0x00);                    /* unknown PCI type */
+  frame(7, 1, 0x01, 0x00);                    /* too short */
+  frame(8, 9, 0x05, 0x00);                    /* no CAN FD data length */
+  frame(9, 8, 0x10, 0x00);                    /* FF, escaped length fitting 12 bit */
+  g_frames[9].data[2] = 0x00; g_frames[9].data[3] = 0x00; g_frames[9].data[4] = 0x01; g_frames[9].data[5] = 0x00;
+  frame(10, 12, 0x05, 0x00);                  /* CAN FD SF without the escape */
+
+  LONGS_EQUAL( 8, isotp_classify_frames(g_frames, 11, &g_classes) );
+
+  LONGS_EQUAL( ISOTP_PCI_TYPE_SINGLE, g_type[0] );
+  LONGS_EQUAL( 5, g_length[0] );
+  LONGS_EQUAL( ISOTP_PCI_TYPE_SINGLE, g_type[1] );
+  LONGS_EQUAL( 48, g_length[1] );
+  LONGS_EQUAL( ISOTP_PCI_TYPE_FIRST_FRAME, g_type[2] );
+  LONGS_EQUAL( 0xABC, g_length[2] );
+  LONGS_EQUAL( 0x12345, g_length[3] );
+  LONGS_EQUAL( TSOTP_PCI_TYPE_CONSECUTIVE_FRAME, g_type[4] );
+  LONGS_EQUAL( 15, g_sn[4] );
+  LONGS_EQUAL( ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME, g_type[5] );
+  LONGS_EQUAL( PCI_FLOW_STATUS_WAIT, g_sn[5] );
+  LONGS_EQUAL( 8, g_length[5] );
+  for (int i = 6; i < 9; i++)
+  {
+    LONGS_EQUAL( ISOTP_FRAME_TYPE_INVALID, g_type[i] );
+    LONGS_EQUAL( 0, g_length[i] );
+  }
+  LONGS_EQUAL( ISOTP_PCI_TYPE_FIRST_FRAME, g_type[9] );
+  LONGS_EQUAL( 0, g_length[9] );
+  LONGS_EQUAL( ISOTP_PCI_TYPE_SINGLE, g_type[10] );
+  LONGS_EQUAL( 0, g_length[10] );
+}
+
+TEST(ISOTP_CLASSIFY, ReceiveClassified)
+{
+  IsoTpLink link;
+  uint8_t recv_buf[ 64 ];
+  IsoTpClock clock = { 0, 0 };
+
+  isotp_init_link_static(&link, 0x700, NULL, 0, recv_buf, sizeof( recv_buf ));
+  isotp_set_user_ops(&link, &null_bus_ops, NULL);
+
+  frame(0, 12, 0x00, 0x0A);                   /* CAN FD SF, escaped 10 bytes */
+  frame(1, 12, 0x05, 0x00);                   /* CAN FD SF without the escape */
+  LONGS_EQUAL( 2, isotp_classify_frames(g_frames, 2, &g_classes) );
+
+  ENUMS_EQUAL_INT( ISOTP_RET_LENGTH, isotp_on_can_message_classified(&link, g_frames[1].data, g_frames[1].len,
+                                                                     g_type[1], g_sn[1], g_length[1], &clock) );
+  ENUMS_EQUAL_INT( ISOTP_RECEIVE_STATUS_IDLE, link.receive_status );
+  ENUMS_EQUAL_INT( ISOTP_RET_OK, isotp_on_can_message_classified(&link, g_frames[0].data, g_frames[0].len,
+                                                                 g_type[0], g_sn[0], g_length[0], &clock) );
+  ENUMS_EQUAL_INT( ISOTP_RECEIVE_STATUS_FULL, link.receive_status );
+  LONGS_EQUAL( 10, link.receive_size );
+}
+
+TEST(ISOTP_CLASSIFY, VectorMatchesScalar)
+{
+  static const uint8_t lens[] = { 0, 1, 2, 3, 8, 12, 13, 64 };
+  uint32_t seed = 12345;
+  uint32_t expected_valid = 0;
+
+  for (uint32_t i = 0; i < CLASSIFY_FRAMES; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    frame(i, lens[(seed >> 8) % sizeof( lens )], (uint8_t)(seed >> 16), (uint8_t)(seed >> 24));
+    g_frames[i].data[2] = 1;
+  }
+
+  /* 6 full vectors and a 4 frame tail */
+  const uint32_t valid = isotp_classify_frames(g_frames, CLASSIFY_FRAMES, &g_classes);
+
+  for (uint32_t i = 0; i < CLASSIFY_FRAMES; i++)
+  {
+    const uint8_t len = g_frames[i].len;
+    const uint8_t high = g_frames[i].data[0] >> 4;
+    const uint8_t low = g_frames[i].data[0] & 0x0F;
+    const bool ok = (len >= 2 && len <= 8) || len == 12 || len == 64;
+
+    if (!ok || high > 3)
+    {
+      LONGS_EQUAL( ISOTP_FRAME_TYPE_INVALID, g_type[i] );
+      continue;
+    }
+
+    expected_valid++;
+    LONGS_EQUAL( high, g_type[i] );
+    LONGS_EQUAL( (high >= 2) ? low : 0, g_sn[i] );
+    switch (high)
+    {
+      case 0: LONGS_EQUAL( (len > 8) ? (low == 0 ? g_frames[i].data[1] : 0) : low, g_length[i] ); break;
+      case 1: LONGS_EQUAL( (low == 0 && g_frames[i].data[1] == 0) ? (len >= 6 ? 0x01000000 : 0) : ((low << 8) | g_frames[i].data[1]), g_length[i] ); break;
+      case 2: LONGS_EQUAL( 0, g_length[i] ); break;
+      default: LONGS_EQUAL( g_frames[i].data[1], g_length[i] ); break;
+    }
+  }
+  LONGS_EQUAL( expected_valid, valid );
+}
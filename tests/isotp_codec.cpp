@@ -0,0 +1,71 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_codec.h"
+
+TEST_GROUP(ISOTP_CODEC)
+{
+  uint8_t g_frame[ ISO_TP_MAX_FRAME_SIZE ];
+
+  void setup()
+  {
+    memset( g_frame, 0xCC, sizeof( g_frame ) );
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_CODEC, Encode)
+{
+  /* the PCI bytes are the same on every target, whatever its byte order */
+  isotp_codec_put_pci(g_frame, ISOTP_PCI_TYPE_SINGLE, 7);
+  LONGS_EQUAL( 0x07, g_frame[0] );
+
+  isotp_codec_put_pci(g_frame, TSOTP_PCI_TYPE_CONSECUTIVE_FRAME, 0x1F);
+  LONGS_EQUAL( 0x2F, g_frame[0] );
+
+  LONGS_EQUAL( 2, isotp_codec_put_ff(g_frame, 0xABC) );
+  LONGS_EQUAL( 0x1A, g_frame[0] );
+  LONGS_EQUAL( 0xBC, g_frame[1] );
+  LONGS_EQUAL( 0xCC, g_frame[2] );
+
+  LONGS_EQUAL( 6, isotp_codec_put_ff(g_frame, 0x00012345) );
+  const uint8_t escaped[ 6 ] = { 0x10, 0x00, 0x00, 0x01, 0x23, 0x45 };
+  MEMCMP_EQUAL( escaped, g_frame, sizeof( escaped ) );
+
+  isotp_codec_put_fc(g_frame, PCI_FLOW_STATUS_WAIT, 8, 0xF3);
+  const uint8_t flow_control[ 3 ] = { 0x31, 0x08, 0xF3 };
+  MEMCMP_EQUAL( flow_control, g_frame, sizeof( flow_control ) );
+}
+
+TEST(ISOTP_CODEC, Decode)
+{
+  const uint8_t first_frame[ 8 ] = { 0x1F, 0xFF, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  const uint8_t escaped[ 8 ] = { 0x10, 0x00, 0x80, 0x00, 0x10, 0x00, 0x01, 0x02 };
+  const uint8_t flow_control[ 3 ] = { 0x32, 0x00, 0x7F };
+
+  LONGS_EQUAL( ISOTP_PCI_TYPE_FIRST_FRAME, isotp_codec_type(first_frame) );
+  LONGS_EQUAL( 0x0F, isotp_codec_nibble(first_frame) );
+  LONGS_EQUAL( ISOTP_MAX_FF_DL, isotp_codec_ff_dl(first_frame) );
+
+  LONGS_EQUAL( 0, isotp_codec_ff_dl(escaped) );
+  LONGS_EQUAL( 0x80001000, isotp_codec_get_be32(&escaped[ISOTP_CODEC_FF_ESC_DL]) );
+
+  LONGS_EQUAL( ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME, isotp_codec_type(flow_control) );
+  LONGS_EQUAL( PCI_FLOW_STATUS_OVERFLOW, isotp_codec_nibble(flow_control) );
+  LONGS_EQUAL( 0x7F, flow_control[ISOTP_CODEC_FC_STMIN] );
+
+  /* round trip of both FF_DL encodings */
+  const uint32_t lengths[] = { 8, ISOTP_MAX_FF_DL, ISOTP_MAX_FF_DL + 1, 0xFFFFFFFF };
+  for (uint32_t i = 0; i < sizeof( lengths ) / sizeof( lengths[0] ); i++)
+  {
+    const uint8_t pci_length = isotp_codec_put_ff(g_frame, lengths[i]);
+    const uint32_t ff_dl = isotp_codec_ff_dl(g_frame);
+
+    LONGS_EQUAL( ISOTP_PCI_TYPE_FIRST_FRAME, isotp_codec_type(g_frame) );
+    LONGS_EQUAL( lengths[i], (0 != ff_dl) ? ff_dl : isotp_codec_get_be32(&g_frame[ISOTP_CODEC_FF_ESC_DL]) );
+    LONGS_EQUAL( (0 != ff_dl) ? 2 : 6, pci_length );
+  }
+}
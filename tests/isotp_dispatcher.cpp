@@ -0,0 +1,190 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_dispatcher.h"
+
+#define ISOTP_CAN_ID        ( 0x700 )
+#define ISOTP_BUFSIZE       ( 16 )
+#define ISOTP_LINKS         ( 300 )
+#define ISOTP_TABLE_SIZE    ( 512 )
+
+TEST_GROUP(ISOTP_DISPATCHER)
+{
+  IsoTpDispatcher g_dispatcher;
+  IsoTpDispatcherEntry g_entries[ISOTP_TABLE_SIZE];
+
+  IsoTpLink g_linkStorage[ISOTP_LINKS];
+  IsoTpLink *g_links[ISOTP_LINKS];
+  uint8_t g_isotpRecvBuf[ISOTP_LINKS][ISOTP_BUFSIZE];
+
+  void setup()
+  {
+    LONGS_EQUAL( isotp_dispatcher_init(&g_dispatcher, g_entries, ISOTP_TABLE_SIZE), ISOTP_RET_OK );
+
+    for (int i = 0; i < ISOTP_LINKS; i++)
+    {
+      g_links[i] = &g_linkStorage[i];
+      isotp_init_link_static(g_links[i], ISOTP_CAN_ID + i, NULL, 0, g_isotpRecvBuf[i], ISOTP_BUFSIZE);
+      /* same CAN IDs on two buses */
+      LONGS_EQUAL( isotp_dispatcher_register(&g_dispatcher, i % 2, 0x100 + i / 2, g_links[i]), ISOTP_RET_OK );
+    }
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_DISPATCHER, Init)
+{
+  IsoTpDispatcher dispatcher;
+  IsoTpDispatcherEntry entries[3];
+
+  LONGS_EQUAL( isotp_dispatcher_init(&dispatcher, entries, 3), ISOTP_RET_ERROR );
+  LONGS_EQUAL( g_dispatcher.count, ISOTP_LINKS );
+}
+
+TEST(ISOTP_DISPATCHER, Find)
+{
+  for (int i = 0; i < ISOTP_LINKS; i++)
+  {
+    POINTERS_EQUAL( isotp_dispatcher_find(&g_dispatcher, i % 2, 0x100 + i / 2), g_links[i] );
+    LONGS_EQUAL( g_links[i]->receive_arbitration_id, 0x100 + i / 2 );
+  }
+
+  POINTERS_EQUAL( isotp_dispatcher_find(&g_dispatcher, 2, 0x100), nullptr );
+  POINTERS_EQUAL( isotp_dispatcher_find(&g_dispatcher, 0, 0x7FF), nullptr );
+}
+
+TEST(ISOTP_DISPATCHER, RegisterTwice)
+{
+  LONGS_EQUAL( isotp_dispatcher_register(&g_dispatcher, 0, 0x100, g_links[1]), ISOTP_RET_ERROR );
+  POINTERS_EQUAL( isotp_dispatcher_find(&g_dispatcher, 0, 0x100), g_links[0] );
+}
+
+TEST(ISOTP_DISPATCHER, RegisterFull)
+{
+  IsoTpDispatcher dispatcher;
+  IsoTpDispatcherEntry entries[4];
+
+  isotp_dispatcher_init(&dispatcher, entries, 4);
+  LONGS_EQUAL( isotp_dispatcher_register(&dispatcher, 0, 1, g_links[0]), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_dispatcher_register(&dispatcher, 0, 2, g_links[1]), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_dispatcher_register(&dispatcher, 0, 3, g_links[2]), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_dispatcher_register(&dispatcher, 0, 4, g_links[3]), ISOTP_RET_OVERFLOW );
+}
+
+TEST(ISOTP_DISPATCHER, Unregister)
+{
+  /* remove every other link, the rest must stay reachable */
+  for (int i = 0; i < ISOTP_LINKS; i += 2)
+  {
+    LONGS_EQUAL( isotp_dispatcher_unregister(&g_dispatcher, i % 2, 0x100 + i / 2), ISOTP_RET_OK );
+  }
+  LONGS_EQUAL( isotp_dispatcher_unregister(&g_dispatcher, 0, 0x100), ISOTP_RET_NO_LINK );
+  LONGS_EQUAL( g_dispatcher.count, ISOTP_LINKS / 2 );
+
+  for (int i = 0; i < ISOTP_LINKS; i++)
+  {
+    POINTERS_EQUAL( isotp_dispatcher_find(&g_dispatcher, i % 2, 0x100 + i / 2), (i % 2) ? g_links[i] : nullptr );
+  }
+}
+
+TEST(ISOTP_DISPATCHER, OnCanMessage)
+{
+  const uint8_t single_frame[ 4 ] = { 0x03, 0x0A, 0x0B, 0x0C };
+
+  int ret = isotp_dispatcher_on_can_message(&g_dispatcher, 1, 0x105, single_frame, sizeof( single_frame ));
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( g_links[11]->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  ENUMS_EQUAL_INT( g_links[10]->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  LONGS_EQUAL( g_links[11]->receive_size, 3 );
+
+  ret = isotp_dispatcher_on_can_message(&g_dispatcher, 3, 0x105, single_frame, sizeof( single_frame ));
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_NO_LINK );
+}
+
+TEST(ISOTP_DISPATCHER, OnCanMessages)
+{
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  IsoTpCanFrame frames[ 4 ];
+
+  /* first frames for three links and one unknown ID */
+  for (int i = 0; i < 4; i++)
+  {
+    frames[i].arbitration_id = 0x100 + i;
+    frames[i].len = sizeof( first_frame );
+    memcpy( frames[i].data, first_frame, sizeof( first_frame ) );
+  }
+  frames[3].arbitration_id = 0x7FF;
+
+  mock().expectNCalls(3, "isotp_user_send_can");
+  mock().expectOneCall("isotp_user_get_us");
+
+  int ret = isotp_dispatcher_on_can_messages(&g_dispatcher, 0, frames, 4);
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_NO_LINK );
+
+  for (int i = 0; i < 3; i++)
+  {
+    ENUMS_EQUAL_INT( g_links[2 * i]->receive_status, ISOTP_RECEIVE_STATUS_INPROGRESS );
+    ENUMS_EQUAL_INT( g_links[2 * i + 1]->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  }
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_DISPATCHER, OnCanMessagesMultiFrame)
+{
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  const uint8_t consecutive_frame[ 4 ] = { 0x21, 0x07, 0x08, 0x09 };
+  const uint8_t message[ 9 ] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 };
+  IsoTpCanFrame frames[ 3 ];
+
+  /* the whole message in one batch, then a consecutive frame nobody waits for */
+  frames[0].arbitration_id = 0x100;
+  frames[0].len = sizeof( first_frame );
+  memcpy( frames[0].data, first_frame, sizeof( first_frame ) );
+  frames[1].arbitration_id = 0x100;
+  frames[1].len = sizeof( consecutive_frame );
+  memcpy( frames[1].data, consecutive_frame, sizeof( consecutive_frame ) );
+  frames[2] = frames[1];
+  frames[2].arbitration_id = 0x101;
+
+  mock().expectOneCall("isotp_user_send_can");
+  mock().expectOneCall("isotp_user_get_us");
+  mock().expectOneCall("isotp_user_debug");
+
+  int ret = isotp_dispatcher_on_can_messages(&g_dispatcher, 0, frames, 3);
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_ERROR );
+  ENUMS_EQUAL_INT( g_links[0]->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( g_links[0]->receive_size, sizeof( message ) );
+  MEMCMP_EQUAL( message, g_isotpRecvBuf[0], sizeof( message ) );
+  ENUMS_EQUAL_INT( g_links[2]->receive_protocol_result, ISOTP_PROTOCOL_RESULT_UNEXP_PDU );
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_DISPATCHER, NextDeadline)
+{
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  uint32_t deadline = 0;
+
+  ENUMS_EQUAL_INT( isotp_dispatcher_next_deadline(&g_dispatcher, &deadline), ISOTP_RET_NO_DATA );
+
+  mock().expectNCalls(2, "isotp_user_send_can");
+  mock().expectNCalls(2, "isotp_user_get_us");
+  isotp_dispatcher_on_can_message(&g_dispatcher, 0, 0x120, first_frame, sizeof( first_frame ));
+  isotp_dispatcher_on_can_message(&g_dispatcher, 1, 0x110, first_frame, sizeof( first_frame ));
+  mock().checkExpectations();
+
+  ENUMS_EQUAL_INT( isotp_dispatcher_next_deadline(&g_dispatcher, &deadline), ISOTP_RET_OK );
+  LONGS_EQUAL( deadline, g_links[0x40]->receive_timer_cr + 1 );
+  CHECK( g_links[0x21]->receive_timer_cr > g_links[0x40]->receive_timer_cr );
+}
+
+TEST(ISOTP_DISPATCHER, Poll)
+{
+  mock().expectNCalls(ISOTP_LINKS, "isotp_user_get_us");
+  isotp_dispatcher_poll(&g_dispatcher);
+  mock().checkExpectations();
+}
@@ -0,0 +1,194 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define ISOTP_TX_ID         ( 0x600 )
+#define ISOTP_RX_ID         ( 0x700 )
+#define ISOTP_BUFSIZE       ( 64 )
+#define ENGINE_LINKS        ( 32 )
+
+/* one link and what its shard did with it */
+typedef struct {
+  IsoTpLink link;
+  uint8_t recv_buf[ ISOTP_BUFSIZE ];
+  std::atomic<uint32_t> frames;
+  std::atomic<uint32_t> indications;
+} EngineNode;
+
+static int engine_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
+{
+  (void)arbitration_id;
+  (void)data;
+  (void)size;
+  ((EngineNode *)ctx)->frames++;
+  return ISOTP_RET_OK;
+}
+
+static uint32_t engine_get_us(void *ctx)
+{
+  (void)ctx;
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void engine_indication(IsoTpLink *link, void *ctx, int result, const uint8_t *payload, uint32_t size)
+{
+  (void)link;
+  (void)payload;
+  (void)size;
+  if (result == ISOTP_PROTOCOL_RESULT_OK)
+  {
+    ((EngineNode *)ctx)->indications++;
+  }
+}
+
+static const IsoTpUserOps engine_ops = { engine_send_can, engine_get_us, NULL };
+static const IsoTpCallbacks engine_callbacks = { engine_indication, NULL, NULL, NULL };
+
+/* wait up to two seconds for the shards */
+template <typename Condition>
+static bool engine_wait(Condition condition)
+{
+  for (int i = 0; i < 2000 && !condition(); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return condition();
+}
+
+TEST_GROUP(ISOTP_ENGINE)
+{
+  IsoTpEngineConfig g_config;
+  EngineNode g_nodes[ ENGINE_LINKS ];
+
+  void setup()
+  {
+    memset( &g_config, 0, sizeof( g_config ) );
+    g_config.shard_count = 4;
+    g_config.bus_count = 1;
+    g_config.links_per_shard = 64;
+    g_config.ring_size = 64;
+    g_config.wheel_slots = 256;
+    g_config.tick_shift = 10;
+    g_config.get_us = engine_get_us;
+
+    for (int i = 0; i < ENGINE_LINKS; i++)
+    {
+      g_nodes[i].frames = 0;
+      g_nodes[i].indications = 0;
+      isotp_init_link_static(&g_nodes[i].link, ISOTP_TX_ID + i, NULL, 0, g_nodes[i].recv_buf, ISOTP_BUFSIZE);
+      isotp_set_user_ops(&g_nodes[i].link, &engine_ops, &g_nodes[i]);
+      isotp_set_callbacks(&g_nodes[i].link, &engine_callbacks, &g_nodes[i]);
+    }
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_ENGINE, Create)
+{
+  IsoTpEngineConfig config = g_config;
+
+  config.shard_count = 0;
+  POINTERS_EQUAL( NULL, isotp_engine_create(&config) );
+  config = g_config;
+  config.ring_size = 12;
+  POINTERS_EQUAL( NULL, isotp_engine_create(&config) );
+
+  IsoTpEngine *engine = isotp_engine_create(&g_config);
+  CHECK( engine != NULL );
+  LONGS_EQUAL( isotp_engine_register(engine, 1, ISOTP_RX_ID, &g_nodes[0].link), ISOTP_RET_ERROR );
+  isotp_engine_destroy(engine);
+}
+
+TEST(ISOTP_ENGINE, ShardOf)
+{
+  uint32_t per_shard[ 4 ] = { 0 };
+  IsoTpEngine *engine = isotp_engine_create(&g_config);
+
+  /* consecutive diagnostic IDs spread evenly */
+  for (uint32_t id = 0; id < 64; id++)
+  {
+    per_shard[isotp_engine_shard_of(engine, 0, ISOTP_RX_ID + id)]++;
+  }
+  for (int shard = 0; shard < 4; shard++)
+  {
+    CHECK( per_shard[shard] >= 12 && per_shard[shard] <= 20 );
+  }
+
+  isotp_engine_destroy(engine);
+}
+
+TEST(ISOTP_ENGINE, SendAndReceive)
+{
+  IsoTpSubmission submissions[ ENGINE_LINKS ];
+  const uint8_t payload[ 4 ] = { 0x01, 0x02, 0x03, 0x04 };
+  const uint8_t single_frame[ 8 ] = { 0x03, 0x11, 0x22, 0x33, 0x00, 0x00, 0x00, 0x00 };
+  IsoTpEngine *engine = isotp_engine_create(&g_config);
+
+  for (int i = 0; i < ENGINE_LINKS; i++)
+  {
+    LONGS_EQUAL( isotp_engine_register(engine, 0, ISOTP_RX_ID + i, &g_nodes[i].link), ISOTP_RET_OK );
+  }
+  LONGS_EQUAL( isotp_engine_start(engine), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_engine_register(engine, 0, ISOTP_RX_ID + ENGINE_LINKS, &g_nodes[0].link), ISOTP_RET_INPROGRESS );
+
+  /* this thread sends on every link and plays the RX thread of bus 0 */
+  for (int i = 0; i < ENGINE_LINKS; i++)
+  {
+    isotp_engine_submit(engine, &submissions[i], &g_nodes[i].link, ISOTP_TX_ID + i, payload, sizeof( payload ));
+    LONGS_EQUAL( isotp_engine_on_can_message(engine, 0, ISOTP_RX_ID + i, single_frame, sizeof( single_frame )), ISOTP_RET_OK );
+  }
+  LONGS_EQUAL( isotp_engine_on_can_message(engine, 1, ISOTP_RX_ID, single_frame, sizeof( single_frame )), ISOTP_RET_ERROR );
+
+  CHECK( engine_wait([&]() {
+    for (int i = 0; i < ENGINE_LINKS; i++)
+    {
+      if (!isotp_submission_done(&submissions[i]) || g_nodes[i].indications != 1)
+      {
+        return false;
+      }
+    }
+    return true;
+  }) );
+  isotp_engine_stop(engine);
+
+  for (int i = 0; i < ENGINE_LINKS; i++)
+  {
+    LONGS_EQUAL( submissions[i].completion.result, ISOTP_PROTOCOL_RESULT_OK );
+    LONGS_EQUAL( 1, g_nodes[i].frames );
+    LONGS_EQUAL( 3, g_nodes[i].link.receive_size );
+  }
+
+  isotp_engine_destroy(engine);
+}
+
+TEST(ISOTP_ENGINE, MultiFrame)
+{
+  IsoTpSubmission submission;
+  uint8_t payload[ 20 ] = { 0 };
+  const uint8_t flow_control[ 3 ] = { 0x30, 0x00, 0x00 };
+  IsoTpEngine *engine = isotp_engine_create(&g_config);
+
+  LONGS_EQUAL( isotp_engine_register(engine, 0, ISOTP_RX_ID, &g_nodes[0].link), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_engine_start(engine), ISOTP_RET_OK );
+
+  isotp_engine_submit(engine, &submission, &g_nodes[0].link, ISOTP_TX_ID, payload, sizeof( payload ));
+  CHECK( engine_wait([&]() { return g_nodes[0].frames == 1; }) );
+  CHECK_FALSE( isotp_submission_done(&submission) );
+
+  /* the flow control lets the shard send the consecutive frames from its timer wheel */
+  LONGS_EQUAL( isotp_engine_on_can_message(engine, 0, ISOTP_RX_ID, flow_control, sizeof( flow_control )), ISOTP_RET_OK );
+  CHECK( engine_wait([&]() { return isotp_submission_done(&submission); }) );
+  LONGS_EQUAL( submission.completion.result, ISOTP_PROTOCOL_RESULT_OK );
+  LONGS_EQUAL( 3, g_nodes[0].frames );
+
+  isotp_engine_destroy(engine);
+}
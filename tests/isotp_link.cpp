@@ -0,0 +1,198 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.hpp"
+
+#include <deque>
+#include <vector>
+
+#define LINK_TX_ID          ( 0x7E0 )
+#define LINK_RX_ID          ( 0x7E8 )
+
+/* frames sent by the links of a test, in order */
+struct LinkBus
+{
+  std::deque<IsoTpCanFrame> frames;
+  uint32_t now_us = 0;
+  int indications = 0;
+  int confirms = 0;
+  int last_result = ISOTP_PROTOCOL_RESULT_ERROR;
+  uint32_t last_size = 0;
+  uint32_t sent = 0;
+};
+
+struct LinkBusConfig : isotp::LinkConfig
+{
+  static int send_can(void *ctx, uint32_t id, const uint8_t *data, uint8_t size)
+  {
+    IsoTpCanFrame frame = { id, size, { 0 } };
+    memcpy( frame.data, data, size );
+    static_cast<LinkBus *>(ctx)->frames.push_back( frame );
+    static_cast<LinkBus *>(ctx)->sent++;
+    return ISOTP_RET_OK;
+  }
+  static uint32_t get_us(void *ctx)
+  {
+    return static_cast<LinkBus *>(ctx)->now_us;
+  }
+};
+
+/* classic CAN, padded, notified by callbacks */
+template <uint32_t Tx, uint32_t Rx>
+struct ClassicConfig : LinkBusConfig
+{
+  static constexpr bool padding = true;
+  static constexpr uint32_t tx_id = Tx;
+  static constexpr uint32_t rx_id = Rx;
+  static constexpr uint32_t send_buffer_size = 64;
+  static constexpr uint32_t receive_buffer_size = 64;
+  static constexpr IsoTpLinkParams params = { 0, 1, 0, 0, 0, 100000, 100000 };   /* fast peer, BS 0 */
+
+  static void on_indication(void *ctx, int result, const uint8_t *payload, uint32_t size)
+  {
+    (void)payload;
+    static_cast<LinkBus *>(ctx)->indications++;
+    static_cast<LinkBus *>(ctx)->last_result = result;
+    static_cast<LinkBus *>(ctx)->last_size = size;
+  }
+  static void on_confirm(void *ctx, int result)
+  {
+    (void)result;
+    static_cast<LinkBus *>(ctx)->confirms++;
+  }
+};
+
+/* CAN FD with normal fixed addressing, no callbacks */
+template <uint8_t Source, uint8_t Target>
+struct FdConfig : LinkBusConfig
+{
+  static constexpr uint8_t frame_size = 64;
+  static constexpr isotp::Addressing addressing = isotp::Addressing::NormalFixed;
+  static constexpr uint8_t source_address = Source;
+  static constexpr uint8_t target_address = Target;
+  static constexpr uint32_t send_buffer_size = 512;
+  static constexpr uint32_t receive_buffer_size = 512;
+};
+
+typedef isotp::Link< ClassicConfig<LINK_TX_ID, LINK_RX_ID> > ClassicTester;
+typedef isotp::Link< ClassicConfig<LINK_RX_ID, LINK_TX_ID> > ClassicEcu;
+typedef isotp::Link< FdConfig<0xF1, 0x10> > FdTester;
+typedef isotp::Link< FdConfig<0x10, 0xF1> > FdEcu;
+
+static_assert(FdTester::tx_id() == 0x18DA10F1, "normal fixed addressing");
+static_assert(FdTester::rx_id() == FdEcu::tx_id(), "peers address each other");
+
+TEST_GROUP(ISOTP_LINK)
+{
+  LinkBus g_bus;
+
+  void teardown()
+  {
+    mock().clear();
+  }
+
+  /* hand every frame to both links, each takes those of its receive ID */
+  template <typename A, typename B>
+  void deliver(A &a, B &b)
+  {
+    while (!g_bus.frames.empty())
+    {
+      const IsoTpCanFrame frame = g_bus.frames.front();
+      g_bus.frames.pop_front();
+      a.on_can_message(frame.arbitration_id, frame.data, frame.len);
+      b.on_can_message(frame.arbitration_id, frame.data, frame.len);
+      a.poll();
+      b.poll();
+    }
+  }
+};
+
+TEST(ISOTP_LINK, ClassicPadded)
+{
+  ClassicTester tester(&g_bus);
+  ClassicEcu ecu(&g_bus);
+  const uint8_t request[ 3 ] = { 0x22, 0xF1, 0x90 };
+  uint8_t payload[ 64 ];
+  uint32_t size = 0;
+
+  LONGS_EQUAL( ISOTP_RET_OK, tester.send(request, sizeof( request )) );
+  LONGS_EQUAL( 1, g_bus.frames.size() );
+  LONGS_EQUAL( 8, g_bus.frames.front().len );
+  LONGS_EQUAL( 0xCC, g_bus.frames.front().data[7] );
+
+  deliver(tester, ecu);
+  LONGS_EQUAL( 1, g_bus.indications );
+  LONGS_EQUAL( ISOTP_RET_OK, ecu.receive(payload, sizeof( payload ), &size) );
+  LONGS_EQUAL( sizeof( request ), size );
+  MEMCMP_EQUAL( request, payload, size );
+
+  /* multi frame answer */
+  g_bus.sent = 0;
+  uint8_t response[ 40 ];
+  for (uint32_t i = 0; i < sizeof( response ); i++)
+  {
+    response[i] = (uint8_t)i;
+  }
+  LONGS_EQUAL( ISOTP_RET_OK, ecu.send(response, sizeof( response )) );
+  deliver(tester, ecu);
+  LONGS_EQUAL( 1 + 1 + 5, g_bus.sent );   /* FF, one FC for the whole message, CFs */
+  LONGS_EQUAL( 2, g_bus.indications );
+  LONGS_EQUAL( sizeof( response ), g_bus.last_size );
+  LONGS_EQUAL( 2, g_bus.confirms );
+  LONGS_EQUAL( ISOTP_RET_OK, tester.receive(payload, sizeof( payload ), &size) );
+  MEMCMP_EQUAL( response, payload, sizeof( response ) );
+
+  /* frames of other IDs do not reach the link */
+  LONGS_EQUAL( ISOTP_RET_NO_LINK, tester.on_can_message(0x123, request, sizeof( request )) );
+}
+
+TEST(ISOTP_LINK, CanFdNormalFixed)
+{
+  FdTester tester(&g_bus);
+  FdEcu ecu(&g_bus);
+  uint8_t request[ 300 ];
+  uint8_t payload[ 512 ];
+  uint32_t size = 0;
+
+  for (uint32_t i = 0; i < sizeof( request ); i++)
+  {
+    request[i] = (uint8_t)(i * 7);
+  }
+
+  LONGS_EQUAL( ISOTP_RET_OK, tester.send(request, sizeof( request )) );
+  LONGS_EQUAL( FdTester::tx_id(), g_bus.frames.front().arbitration_id );
+  LONGS_EQUAL( 64, g_bus.frames.front().len );
+
+  /* the ECU takes its frames out of the whole bus traffic in one batch */
+  while (!g_bus.frames.empty())
+  {
+    std::vector<IsoTpCanFrame> batch(g_bus.frames.begin(), g_bus.frames.end());
+    g_bus.frames.clear();
+    ecu.on_can_messages(batch.data(), (uint16_t)batch.size());
+    for (const IsoTpCanFrame &frame : batch)
+    {
+      tester.on_can_message(frame.arbitration_id, frame.data, frame.len);
+    }
+    tester.poll();
+  }
+  LONGS_EQUAL( ISOTP_RET_OK, ecu.receive(payload, sizeof( payload ), &size) );
+  LONGS_EQUAL( sizeof( request ), size );
+  MEMCMP_EQUAL( request, payload, size );
+  LONGS_EQUAL( 0, g_bus.indications );
+}
+
+TEST(ISOTP_LINK, CanFdPadding)
+{
+  FdTester tester(&g_bus);
+  const uint8_t request[ 11 ] = { 0x2E, 0xF1, 0x90, 1, 2, 3, 4, 5, 6, 7, 8 };
+
+  /* escaped SF of 13 bytes, filled up to the CAN FD data length 16 with padding_byte */
+  LONGS_EQUAL( ISOTP_RET_OK, tester.send(request, sizeof( request )) );
+  LONGS_EQUAL( 16, g_bus.frames.front().len );
+  LONGS_EQUAL( 0x00, g_bus.frames.front().data[0] );
+  LONGS_EQUAL( sizeof( request ), g_bus.frames.front().data[1] );
+  MEMCMP_EQUAL( request, &g_bus.frames.front().data[2], sizeof( request ) );
+  for (int i = 2 + sizeof( request ); i < 16; i++)
+  {
+    LONGS_EQUAL( 0xCC, g_bus.frames.front().data[i] );
+  }
+}
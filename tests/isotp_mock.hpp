@@ -14,6 +14,9 @@ void isotp_user_debug(const char* message)
 int  isotp_user_send_can(const uint32_t arbitration_id,
                          const uint8_t* data, const uint8_t size)
 {
+  (void)arbitration_id;
+  (void)data;
+  (void)size;
   mock().actualCall("isotp_user_send_can");
   return 0;
 }
@@ -6,9 +6,145 @@
 #define ISOTP_CAN_ID        ( 0x700 )
 #define ISOTP_BUFSIZE       ( 128 )
 
+/* Records the service primitives of a link */
+struct CallbackLog {
+  int indications;
+  int indication_result;
+  uint32_t indication_size;
+  uint8_t indication_first;
+  int ff_indications;
+  uint32_t ff_size;
+  int confirms;
+  int confirm_result;
+};
+
+static void log_indication(IsoTpLink *link, void *ctx, int result, const uint8_t *payload, uint32_t size)
+{
+  CallbackLog *log = (CallbackLog *)ctx;
+  (void)link;
+  log->indications++;
+  log->indication_result = result;
+  log->indication_size = size;
+  log->indication_first = size > 0 ? payload[0] : 0;
+}
+
+static void log_ff_indication(IsoTpLink *link, void *ctx, uint32_t size)
+{
+  CallbackLog *log = (CallbackLog *)ctx;
+  (void)link;
+  log->ff_indications++;
+  log->ff_size = size;
+}
+
+static void log_confirm(IsoTpLink *link, void *ctx, int result)
+{
+  CallbackLog *log = (CallbackLog *)ctx;
+  (void)link;
+  log->confirms++;
+  log->confirm_result = result;
+}
+
+static const IsoTpCallbacks log_callbacks = { log_indication, log_ff_indication, log_confirm, NULL };
+
+/* Frames sent by a link, delivered to the peer by the test */
+struct FdWire {
+  uint8_t data[ 4 ][ 64 ];
+  uint8_t len[ 4 ];
+  int count;
+};
+
+static int fd_wire_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t *data, const uint8_t size)
+{
+  FdWire *wire = (FdWire *)ctx;
+  (void)arbitration_id;
+  memcpy( wire->data[ wire->count ], data, size );
+  wire->len[ wire->count++ ] = size;
+  return ISOTP_RET_OK;
+}
+
+static uint32_t fd_wire_get_us(void *ctx)
+{
+  (void)ctx;
+  return 0;
+}
+
+static const IsoTpUserOps fd_wire_ops = { fd_wire_send_can, fd_wire_get_us, NULL };
+
+/* Collects a streamed message, optionally pausing the sender */
+struct StreamSink {
+  uint8_t data[ 256 ];
+  uint32_t size;
+  int chunks;
+  int pause;
+  int indications;
+  int result;
+};
+
+static int sink_receive_chunk(IsoTpLink *link, void *ctx, const uint8_t *data, uint32_t offset, uint32_t size)
+{
+  StreamSink *sink = (StreamSink *)ctx;
+  (void)link;
+  LONGS_EQUAL( sink->size, offset );
+  memcpy( sink->data + offset, data, size );
+  sink->size += size;
+  sink->chunks++;
+  return sink->pause ? ISOTP_RET_INPROGRESS : ISOTP_RET_OK;
+}
+
+static void sink_indication(IsoTpLink *link, void *ctx, int result, const uint8_t *payload, uint32_t size)
+{
+  StreamSink *sink = (StreamSink *)ctx;
+  (void)link;
+  (void)size;
+  POINTERS_EQUAL( NULL, payload );
+  sink->indications++;
+  sink->result = result;
+}
+
+static const IsoTpCallbacks sink_callbacks = { sink_indication, NULL, NULL, sink_receive_chunk };
+
+/* deliver the frames each link has sent to the other one, then poll the sender */
+static void wire_exchange(IsoTpLink *sender, FdWire *tx, IsoTpLink *receiver, FdWire *rx)
+{
+  for (int i = 0; i < tx->count; i++)
+  {
+    isotp_on_can_message( receiver, tx->data[i], tx->len[i] );
+  }
+  tx->count = 0;
+  for (int i = 0; i < rx->count; i++)
+  {
+    isotp_on_can_message( sender, rx->data[i], rx->len[i] );
+  }
+  rx->count = 0;
+  isotp_poll( sender );
+}
+
+/* Generates a message on demand, up to the bytes made available so far */
+struct StreamSource {
+  uint32_t available;
+  int calls;
+};
+
+static int source_produce(IsoTpLink *link, void *ctx, uint8_t *data, uint32_t offset, uint32_t size)
+{
+  StreamSource *source = (StreamSource *)ctx;
+  (void)link;
+  if (offset + size > source->available)
+  {
+    return ISOTP_RET_NO_DATA;
+  }
+  for (uint32_t i = 0; i < size; i++)
+  {
+    data[i] = (uint8_t)((offset + i) * 5);
+  }
+  source->calls++;
+  return ISOTP_RET_OK;
+}
+
 TEST_GROUP(ISOTP_MULTIPLE)
 {
   /* Alloc IsoTpLink statically in RAM */
+  IsoTpLink g_linkStorage;
   IsoTpLink *g_link = nullptr;
   /* Alloc send and receive buffer statically in RAM */
   uint8_t g_isotpRecvBuf[ISOTP_BUFSIZE];
@@ -23,13 +159,13 @@ TEST_GROUP(ISOTP_MULTIPLE)
   void setup()
   {
     /* Initialize link, ISOTP_CAN_ID is the CAN ID you send with */
-    g_link = isotp_init_link(ISOTP_CAN_ID,
+    g_link = &g_linkStorage;
+    isotp_init_link_static(g_link, ISOTP_CAN_ID,
 						g_isotpSendBuf, sizeof(g_isotpSendBuf), 
 						g_isotpRecvBuf, sizeof(g_isotpRecvBuf));           
   }
   void teardown()
   {
-    free( g_link );  
     mock().clear();   
   }  
 };
@@ -60,7 +196,7 @@ TEST(ISOTP_MULTIPLE, Create)
   ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
 
   /* receiver paramters */
-  LONGS_EQUAL( g_link->receive_arbitration_id, 0 );
+  LONGS_EQUAL( g_link->receive_arbitration_id, ISOTP_NO_RX_ID );
 
   /* message buffer */
   CHECK( g_link->receive_buffer != nullptr );                      
@@ -109,7 +245,7 @@ TEST(ISOTP_MULTIPLE, ReceiveMultiFrame)
     ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
     ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
 
-    uint16_t out_size = 0;
+    uint32_t out_size = 0;
     uint8_t payload[ 10 ] = { 0 };
     int ret_outbuf = isotp_receive(g_link, payload, sizeof( payload ), &out_size);
     ENUMS_EQUAL_INT( ret_outbuf, ISOTP_RET_OK );
@@ -122,6 +258,94 @@ TEST(ISOTP_MULTIPLE, ReceiveMultiFrame)
     
 }
 
+TEST(ISOTP_MULTIPLE, ReceiveMultiFrameLease)
+{    
+    mock().expectNCalls(2, "isotp_user_send_can");
+    mock().expectNCalls(2, "isotp_user_get_us");
+    mock().expectOneCall("isotp_user_debug");
+
+    isotp_on_can_message(g_link, first_multi_frame, sizeof( first_multi_frame )); 
+    isotp_on_can_message(g_link, second_multi_frame, sizeof( second_multi_frame )); 
+    ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+
+    const uint8_t *payload = nullptr;
+    uint32_t out_size = 0;
+    int ret_lease = isotp_receive_lease(g_link, &payload, &out_size);
+    ENUMS_EQUAL_INT( ret_lease, ISOTP_RET_OK );
+    LONGS_EQUAL( out_size, 10 );
+    MEMCMP_EQUAL( payload, first_multi_frame + 2, 6 );
+    MEMCMP_EQUAL( payload + 6, second_multi_frame + 1, 4 );
+
+    /* First frame while leased is answered with overflow */
+    isotp_on_can_message(g_link, first_multi_frame, sizeof( first_multi_frame )); 
+    ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW );
+    ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_LEASED );
+
+    ENUMS_EQUAL_INT( isotp_receive_release(g_link), ISOTP_RET_OK );
+    ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+    LONGS_EQUAL( g_link->receive_size, 0 );
+
+    mock().checkExpectations();
+}
+
+TEST(ISOTP_MULTIPLE, ReceiveMultiFrameBatch)
+{    
+    IsoTpCanFrame frames[ 3 ];
+
+    /* a frame of another ID between the first and the consecutive frame */
+    isotp_set_rx_id(g_link, ISOTP_CAN_ID + 8);
+    frames[0].arbitration_id = ISOTP_CAN_ID + 8;
+    frames[0].len = sizeof( first_multi_frame );
+    memcpy( frames[0].data, first_multi_frame, sizeof( first_multi_frame ) );
+    frames[1].arbitration_id = ISOTP_CAN_ID + 9;
+    frames[1].len = sizeof( first_multi_frame );
+    memcpy( frames[1].data, first_multi_frame, sizeof( first_multi_frame ) );
+    frames[2].arbitration_id = ISOTP_CAN_ID + 8;
+    frames[2].len = sizeof( second_multi_frame );
+    memcpy( frames[2].data, second_multi_frame, sizeof( second_multi_frame ) );
+
+    /* one clock read for the whole batch */
+    mock().expectOneCall("isotp_user_send_can");
+    mock().expectOneCall("isotp_user_get_us");
+
+    int ret = isotp_on_can_messages(g_link, frames, 3);
+    ENUMS_EQUAL_INT( ret, ISOTP_RET_NO_LINK );
+    ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+    ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+    LONGS_EQUAL( g_link->receive_size, 10 );
+    LONGS_EQUAL( g_link->receive_offset, 10 );  
+
+    mock().checkExpectations();
+}
+
+TEST(ISOTP_MULTIPLE, ReceiveBatchWithoutRxId)
+{    
+    IsoTpCanFrame frames[ 2 ];
+
+    /* no receive ID set, the frames are taken whatever their ID */
+    frames[0].arbitration_id = 0;
+    frames[0].len = sizeof( first_multi_frame );
+    memcpy( frames[0].data, first_multi_frame, sizeof( first_multi_frame ) );
+    frames[1].arbitration_id = ISOTP_CAN_ID + 8;
+    frames[1].len = sizeof( second_multi_frame );
+    memcpy( frames[1].data, second_multi_frame, sizeof( second_multi_frame ) );
+
+    mock().expectOneCall("isotp_user_send_can");
+    mock().expectOneCall("isotp_user_get_us");
+
+    int ret = isotp_on_can_messages(g_link, frames, 2);
+    ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+    ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+    LONGS_EQUAL( g_link->receive_size, 10 );
+
+    /* once set, a frame with the valid CAN ID 0 is not for this link */
+    isotp_set_rx_id(g_link, ISOTP_CAN_ID + 8);
+    ret = isotp_on_can_messages(g_link, frames, 1);
+    ENUMS_EQUAL_INT( ret, ISOTP_RET_NO_LINK );
+
+    mock().checkExpectations();
+}
+
 TEST(ISOTP_MULTIPLE, SendMultiFrame)
 {
 
@@ -161,6 +385,581 @@ TEST(ISOTP_MULTIPLE, SendMultiFrame)
 
 }
 
+TEST(ISOTP_MULTIPLE, SendMultiFrameNoCopy)
+{
+
+  mock().expectNCalls( 2, "isotp_user_send_can" );
+  mock().expectNCalls( 4, "isotp_user_get_us" );   
+
+  memset( g_isotpSendBuf, 0, sizeof( g_isotpSendBuf ) );
+
+  int ret = isotp_send_nocopy(g_link, send_multi_frame, sizeof( send_multi_frame ));
+
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_INPROGRESS );
+  POINTERS_EQUAL( g_link->send_payload, send_multi_frame );
+  LONGS_EQUAL( g_isotpSendBuf[0], 0 );
+  CHECK_FALSE( isotp_send_buffer_released( g_link ) );
+
+  isotp_poll( g_link );
+  CHECK_FALSE( isotp_send_buffer_released( g_link ) );
+
+  /* Receive flow frame*/ 
+  int ret_msg_can = isotp_on_can_message(g_link, receive_flow_frame, sizeof( receive_flow_frame )); 
+  ENUMS_EQUAL_INT( ret_msg_can, ISOTP_RET_OK );
+
+  isotp_poll( g_link );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
+  LONGS_EQUAL( g_link->send_offset,     10 );
+  CHECK_TRUE( isotp_send_buffer_released( g_link ) );
+    
+  mock().checkExpectations();
+
+}
+
+TEST(ISOTP_MULTIPLE, SendMultiFrameBurst)
+{
+  uint8_t payload[ 41 ];
+  const uint8_t flow_frame_bs[ 3 ] = { 0x30, 0x02, 0x00 };
+  const uint8_t flow_frame_no_bs[ 3 ] = { 0x30, 0x00, 0x00 };
+
+  for (uint8_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = i;
+  }
+
+  /* FF + 5 CF */
+  mock().expectNCalls( 6, "isotp_user_send_can" );
+  mock().expectNCalls( 8, "isotp_user_get_us" );   
+
+  int ret = isotp_send(g_link, payload, sizeof( payload ));
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+
+  /* nothing sent before the first flow control */
+  LONGS_EQUAL( isotp_poll_burst( g_link, 16 ), 0 );
+
+  /* block size limits the burst */
+  isotp_on_can_message(g_link, flow_frame_bs, sizeof( flow_frame_bs )); 
+  LONGS_EQUAL( isotp_poll_burst( g_link, 16 ), 2 );
+  LONGS_EQUAL( g_link->send_offset, 20 );
+  LONGS_EQUAL( isotp_poll_burst( g_link, 16 ), 0 );
+
+  /* budget limits the burst */
+  isotp_on_can_message(g_link, flow_frame_no_bs, sizeof( flow_frame_no_bs )); 
+  LONGS_EQUAL( isotp_poll_burst( g_link, 1 ), 1 );
+  LONGS_EQUAL( g_link->send_offset, 27 );
+
+  /* rest of the message in one call */
+  LONGS_EQUAL( isotp_poll_burst( g_link, 16 ), 2 );
+  LONGS_EQUAL( g_link->send_offset, 41 );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_MULTIPLE, NextDeadline)
+{
+  uint8_t payload[ 41 ] = { 0 };
+  const uint8_t flow_frame_st[ 3 ] = { 0x30, 0x00, 0x0A };
+  uint32_t deadline = 0;
+
+  mock().expectNCalls( 3, "isotp_user_send_can" );
+  mock().expectNCalls( 4, "isotp_user_get_us" );   
+
+  ENUMS_EQUAL_INT( isotp_next_deadline(g_link, &deadline), ISOTP_RET_NO_DATA );
+
+  /* waiting for flow control, only N_Bs */
+  isotp_send(g_link, payload, sizeof( payload ));
+  ENUMS_EQUAL_INT( isotp_next_deadline(g_link, &deadline), ISOTP_RET_OK );
+  LONGS_EQUAL( deadline, g_link->send_timer_bs + 1 );
+
+  /* next consecutive frame after STmin */
+  isotp_on_can_message(g_link, flow_frame_st, sizeof( flow_frame_st )); 
+  isotp_poll( g_link );
+  LONGS_EQUAL( g_link->send_offset, 13 );
+  ENUMS_EQUAL_INT( isotp_next_deadline(g_link, &deadline), ISOTP_RET_OK );
+  LONGS_EQUAL( deadline, g_link->send_timer_st + 1 );
+  LONGS_EQUAL( g_link->send_st_min_us, 10000 );
+
+  /* receiving adds N_Cr, the earliest wins */
+  isotp_on_can_message(g_link, first_multi_frame, sizeof( first_multi_frame )); 
+  ENUMS_EQUAL_INT( isotp_next_deadline(g_link, &deadline), ISOTP_RET_OK );
+  LONGS_EQUAL( deadline, g_link->send_timer_st + 1 );
+  g_link->send_status = ISOTP_SEND_STATUS_IDLE;
+  ENUMS_EQUAL_INT( isotp_next_deadline(g_link, &deadline), ISOTP_RET_OK );
+  LONGS_EQUAL( deadline, g_link->receive_timer_cr + 1 );
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_MULTIPLE, Callbacks)
+{
+  CallbackLog log = {};
+
+  mock().expectNCalls( 3, "isotp_user_send_can" );
+  mock().expectNCalls( 8, "isotp_user_get_us" );
+
+  isotp_set_callbacks( g_link, &log_callbacks, &log );
+
+  /* Receive multi frame */
+  isotp_on_can_message( g_link, first_multi_frame, sizeof( first_multi_frame ) );
+  LONGS_EQUAL( log.ff_indications, 1 );
+  LONGS_EQUAL( log.ff_size, 10 );
+  LONGS_EQUAL( log.indications, 0 );
+
+  isotp_poll( g_link );
+  isotp_on_can_message( g_link, second_multi_frame, sizeof( second_multi_frame ) );
+  isotp_poll( g_link );
+  LONGS_EQUAL( log.indications, 1 );
+  ENUMS_EQUAL_INT( log.indication_result, ISOTP_PROTOCOL_RESULT_OK );
+  LONGS_EQUAL( log.indication_size, 10 );
+  LONGS_EQUAL( log.indication_first, first_multi_frame[2] );
+
+  /* Send multi frame, confirmed after the last consecutive frame */
+  isotp_send( g_link, send_multi_frame, sizeof( send_multi_frame ) );
+  isotp_poll( g_link );
+  isotp_on_can_message( g_link, receive_flow_frame, sizeof( receive_flow_frame ) );
+  LONGS_EQUAL( log.confirms, 0 );
+
+  isotp_poll( g_link );
+  LONGS_EQUAL( log.confirms, 1 );
+  ENUMS_EQUAL_INT( log.confirm_result, ISOTP_PROTOCOL_RESULT_OK );
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_MULTIPLE, CanFdMultiFrame)
+{
+  IsoTpLink receiver;
+  uint8_t receiver_buf[ ISOTP_BUFSIZE ];
+  FdWire tx = {};
+  FdWire rx = {};
+  uint8_t payload[ 100 ];
+
+  for (uint8_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = (uint8_t)(i * 3);
+  }
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+  ENUMS_EQUAL_INT( isotp_set_tx_dl( g_link, 64 ), ISOTP_RET_OK );
+
+  /* first frame carries 62 bytes */
+  ENUMS_EQUAL_INT( isotp_send( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  LONGS_EQUAL( tx.count, 1 );
+  LONGS_EQUAL( tx.len[0], 64 );
+  LONGS_EQUAL( g_link->send_offset, 62 );
+
+  ENUMS_EQUAL_INT( isotp_on_can_message( &receiver, tx.data[0], tx.len[0] ), ISOTP_RET_OK );
+  LONGS_EQUAL( receiver.receive_rx_dl, 64 );
+  LONGS_EQUAL( rx.count, 1 );
+  LONGS_EQUAL( rx.len[0], 3 );
+
+  /* remaining 38 bytes in one consecutive frame, padded to 48 */
+  ENUMS_EQUAL_INT( isotp_on_can_message( g_link, rx.data[0], rx.len[0] ), ISOTP_RET_OK );
+  isotp_poll( g_link );
+  LONGS_EQUAL( tx.count, 2 );
+  LONGS_EQUAL( tx.len[1], 48 );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
+
+  ENUMS_EQUAL_INT( isotp_on_can_message( &receiver, tx.data[1], tx.len[1] ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+
+  uint8_t out[ ISOTP_BUFSIZE ];
+  uint32_t out_size = 0;
+  ENUMS_EQUAL_INT( isotp_receive( &receiver, out, sizeof( out ), &out_size ), ISOTP_RET_OK );
+  LONGS_EQUAL( out_size, sizeof( payload ) );
+  MEMCMP_EQUAL( payload, out, sizeof( payload ) );
+}
+
+TEST(ISOTP_MULTIPLE, LinkParams)
+{
+  IsoTpLink receiver;
+  uint8_t receiver_buf[ ISOTP_BUFSIZE ];
+  FdWire tx = {};
+  FdWire rx = {};
+  uint8_t payload[ 20 ] = { 0 };
+  const IsoTpLinkParams slow = { 2, 1, 1, 0xAA, 500, 100000, 100000 };
+  const IsoTpLinkParams invalid = { 2, 1, 1, 0xAA, 200000, 100000, 100000 };
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+  ENUMS_EQUAL_INT( isotp_set_params( &receiver, &invalid ), ISOTP_RET_ERROR );
+  ENUMS_EQUAL_INT( isotp_set_params( &receiver, &slow ), ISOTP_RET_OK );
+
+  /* flow control of the receiver carries its BS and STmin, 500 us encoded as 0xF5, padded */
+  ENUMS_EQUAL_INT( isotp_send( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_on_can_message( &receiver, tx.data[0], tx.len[0] ), ISOTP_RET_OK );
+  LONGS_EQUAL( rx.count, 1 );
+  LONGS_EQUAL( rx.len[0], 8 );
+  LONGS_EQUAL( rx.data[0][0], 0x30 );
+  LONGS_EQUAL( rx.data[0][1], 2 );
+  LONGS_EQUAL( rx.data[0][2], 0xF5 );
+  LONGS_EQUAL( rx.data[0][7], 0xAA );
+  ENUMS_EQUAL_INT( isotp_set_params( &receiver, NULL ), ISOTP_RET_INPROGRESS );
+
+  /* the sender keeps the requested gap */
+  ENUMS_EQUAL_INT( isotp_on_can_message( g_link, rx.data[0], rx.len[0] ), ISOTP_RET_OK );
+  LONGS_EQUAL( g_link->send_bs_remain, 2 );
+  LONGS_EQUAL( g_link->send_st_min_us, 500 );
+
+  /* defaults again between messages */
+  receiver.receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+  ENUMS_EQUAL_INT( isotp_set_params( &receiver, NULL ), ISOTP_RET_OK );
+  LONGS_EQUAL( receiver.params->block_size, ISO_TP_DEFAULT_BLOCK_SIZE );
+}
+
+TEST(ISOTP_MULTIPLE, EscapedFirstFrame)
+{
+  static uint8_t payload[ 5000 ];
+  static uint8_t receiver_buf[ 5000 ];
+  IsoTpLink receiver;
+  FdWire tx = {};
+  FdWire rx = {};
+
+  for (uint32_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = (uint8_t)(i ^ (i >> 8));
+  }
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+  ENUMS_EQUAL_INT( isotp_set_tx_dl( g_link, 64 ), ISOTP_RET_OK );
+
+  /* FF_DL above 4095 goes into the 32 bit escape */
+  ENUMS_EQUAL_INT( isotp_send_nocopy( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  LONGS_EQUAL( tx.len[0], 64 );
+  LONGS_EQUAL( tx.data[0][0], 0x10 );
+  LONGS_EQUAL( tx.data[0][1], 0x00 );
+  LONGS_EQUAL( tx.data[0][4], 0x13 );
+  LONGS_EQUAL( tx.data[0][5], 0x88 );
+  LONGS_EQUAL( g_link->send_offset, 58 );
+
+  while( g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS )
+  {
+    for (int i = 0; i < tx.count; i++)
+    {
+      ENUMS_EQUAL_INT( isotp_on_can_message( &receiver, tx.data[i], tx.len[i] ), ISOTP_RET_OK );
+    }
+    tx.count = 0;
+    for (int i = 0; i < rx.count; i++)
+    {
+      isotp_on_can_message( g_link, rx.data[i], rx.len[i] );
+    }
+    rx.count = 0;
+    isotp_poll( g_link );
+  }
+  for (int i = 0; i < tx.count; i++)
+  {
+    isotp_on_can_message( &receiver, tx.data[i], tx.len[i] );
+  }
+
+  ENUMS_EQUAL_INT( g_link->send_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( receiver.receive_size, sizeof( payload ) );
+  MEMCMP_EQUAL( payload, receiver_buf, sizeof( payload ) );
+
+  /* too large for the receive buffer, refused by FC overflow */
+  const uint8_t escaped_frame[ 8 ] = { 0x10, 0x00, 0x00, 0x00, 0x13, 0x89, 0x01, 0x02 };
+  const uint8_t *received = nullptr;
+  uint32_t received_size = 0;
+  rx.count = 0;
+  isotp_receive_lease( &receiver, &received, &received_size );
+  isotp_receive_release( &receiver );
+  ENUMS_EQUAL_INT( isotp_on_can_message( &receiver, escaped_frame, sizeof( escaped_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( receiver.receive_protocol_result, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW );
+  LONGS_EQUAL( rx.count, 1 );
+  LONGS_EQUAL( rx.data[0][0], 0x30 | PCI_FLOW_STATUS_OVERFLOW );
+}
+
+TEST(ISOTP_MULTIPLE, ReceiveAbove64KiB)
+{
+  static uint8_t payload[ 70000 ];
+  static uint8_t receiver_buf[ 70000 ];
+  static uint8_t out[ 70000 ];
+  uint32_t out_size = 0;
+  IsoTpLink receiver;
+  FdWire tx = {};
+  FdWire rx = {};
+
+  for (uint32_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+  }
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+  ENUMS_EQUAL_INT( isotp_set_tx_dl( g_link, 64 ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send_nocopy( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+
+  while( g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS )
+  {
+    for (int i = 0; i < tx.count; i++)
+    {
+      isotp_on_can_message( &receiver, tx.data[i], tx.len[i] );
+    }
+    tx.count = 0;
+    for (int i = 0; i < rx.count; i++)
+    {
+      isotp_on_can_message( g_link, rx.data[i], rx.len[i] );
+    }
+    rx.count = 0;
+    isotp_poll( g_link );
+  }
+  for (int i = 0; i < tx.count; i++)
+  {
+    isotp_on_can_message( &receiver, tx.data[i], tx.len[i] );
+  }
+
+  /* the size is not truncated to 16 bit when copied out */
+  ENUMS_EQUAL_INT( isotp_receive( &receiver, out, sizeof( out ) - 1, &out_size ), ISOTP_RET_OVERFLOW );
+  receiver.receive_status = ISOTP_RECEIVE_STATUS_FULL;
+  ENUMS_EQUAL_INT( isotp_receive( &receiver, out, sizeof( out ), &out_size ), ISOTP_RET_OK );
+  LONGS_EQUAL( out_size, sizeof( payload ) );
+  MEMCMP_EQUAL( payload, out, sizeof( payload ) );
+}
+
+TEST(ISOTP_MULTIPLE, StreamingReceive)
+{
+  IsoTpLink receiver;
+  uint8_t staging[ 16 ];
+  uint8_t payload[ 200 ];
+  StreamSink sink = {};
+  FdWire tx = {};
+  FdWire rx = {};
+
+  for (uint32_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = (uint8_t)(i * 7);
+  }
+
+  /* message far larger than the receive buffer */
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, staging, sizeof( staging ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_callbacks( &receiver, &sink_callbacks, &sink );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+
+  sink.pause = 1;
+  ENUMS_EQUAL_INT( isotp_send_nocopy( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  for (int i = 0; i < 20 && 0 == receiver.receive_wait_count; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+
+  /* sender held with FC.WAIT after the block */
+  LONGS_EQUAL( 1, receiver.receive_wait_count );
+  LONGS_EQUAL( 1, g_link->send_wtf_count );
+  LONGS_EQUAL( 6 + 8 * 7, receiver.receive_offset );
+  CHECK( sink.chunks > 0 );
+
+  wire_exchange( g_link, &tx, &receiver, &rx );
+  wire_exchange( g_link, &tx, &receiver, &rx );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_INPROGRESS );
+  LONGS_EQUAL( 0, tx.count );
+  LONGS_EQUAL( 6 + 8 * 7, receiver.receive_offset );
+
+  /* resume, clear to send */
+  sink.pause = 0;
+  ENUMS_EQUAL_INT( isotp_receive_resume( &receiver ), ISOTP_RET_OK );
+  LONGS_EQUAL( 0, receiver.receive_wait_count );
+  LONGS_EQUAL( 0x30 | PCI_FLOW_STATUS_CONTINUE, rx.data[0][0] );
+
+  for (int i = 0; i < 40 && g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+  wire_exchange( g_link, &tx, &receiver, &rx );
+
+  ENUMS_EQUAL_INT( g_link->send_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  LONGS_EQUAL( 1, sink.indications );
+  ENUMS_EQUAL_INT( sink.result, ISOTP_PROTOCOL_RESULT_OK );
+  LONGS_EQUAL( sizeof( payload ), sink.size );
+  MEMCMP_EQUAL( payload, sink.data, sizeof( payload ) );
+}
+
+TEST(ISOTP_MULTIPLE, StreamingReceiveNoWait)
+{
+  IsoTpLink receiver;
+  IsoTpLinkParams params = ISOTP_LINK_PARAMS_DEFAULT;
+  uint8_t staging[ 16 ];
+  uint8_t payload[ 200 ];
+  StreamSink sink = {};
+  FdWire tx = {};
+  FdWire rx = {};
+
+  memset( payload, 0x5A, sizeof( payload ) );
+
+  /* WFTmax 0, the receiver may not send FC.WAIT */
+  params.wft_max = 0;
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, staging, sizeof( staging ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_callbacks( &receiver, &sink_callbacks, &sink );
+  ENUMS_EQUAL_INT( isotp_set_params( &receiver, &params ), ISOTP_RET_OK );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+
+  sink.pause = 1;
+  ENUMS_EQUAL_INT( isotp_send_nocopy( g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  for (int i = 0; i < 20 && 0 == sink.indications; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+
+  /* the paused block ends the reception with FC.OVFLW instead */
+  LONGS_EQUAL( 1, sink.indications );
+  ENUMS_EQUAL_INT( sink.result, ISOTP_PROTOCOL_RESULT_WFT_OVRN );
+  ENUMS_EQUAL_INT( receiver.receive_protocol_result, ISOTP_PROTOCOL_RESULT_WFT_OVRN );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  LONGS_EQUAL( 0, receiver.receive_wait_count );
+  LONGS_EQUAL( 0, g_link->send_wtf_count );
+
+  wire_exchange( g_link, &tx, &receiver, &rx );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_ERROR );
+  ENUMS_EQUAL_INT( g_link->send_protocol_result, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW );
+}
+
+TEST(ISOTP_MULTIPLE, StreamingSend)
+{
+  IsoTpLink receiver;
+  uint8_t receiver_buf[ ISOTP_BUFSIZE ];
+  StreamSource source = { 20, 0 };
+  FdWire tx = {};
+  FdWire rx = {};
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+
+  /* first frame leaves before the message is complete */
+  ENUMS_EQUAL_INT( isotp_send_stream( g_link, 100, source_produce, &source ), ISOTP_RET_OK );
+  LONGS_EQUAL( 1, tx.count );
+  LONGS_EQUAL( 100, tx.data[0][1] );
+
+  /* stalls at the bytes not produced yet */
+  for (int i = 0; i < 10; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_INPROGRESS );
+  LONGS_EQUAL( 20, g_link->send_offset );
+  LONGS_EQUAL( 3, source.calls );
+
+  source.available = 100;
+  for (int i = 0; i < 20 && g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+  wire_exchange( g_link, &tx, &receiver, &rx );
+
+  ENUMS_EQUAL_INT( g_link->send_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( 100, receiver.receive_size );
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    LONGS_EQUAL( (uint8_t)(i * 5), receiver_buf[i] );
+  }
+}
+
+TEST(ISOTP_MULTIPLE, SendScatterGather)
+{
+  IsoTpLink receiver;
+  uint8_t receiver_buf[ ISOTP_BUFSIZE ];
+  const uint8_t header[ 3 ] = { 0x76, 0x01, 0x02 };
+  uint8_t body[ 60 ];
+  FdWire tx = {};
+  FdWire rx = {};
+
+  for (uint8_t i = 0; i < sizeof( body ); i++)
+  {
+    body[i] = (uint8_t)(0x80 + i);
+  }
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+
+  /* single frame from two segments */
+  const IsoTpIoVec short_iov[ 2 ] = { { header, 2 }, { body, 3 } };
+  ENUMS_EQUAL_INT( isotp_sendv( g_link, short_iov, 2 ), ISOTP_RET_OK );
+  const uint8_t expected_sf[ 6 ] = { 0x05, 0x76, 0x01, 0x80, 0x81, 0x82 };
+  LONGS_EQUAL( 6, tx.len[0] );
+  MEMCMP_EQUAL( expected_sf, tx.data[0], sizeof( expected_sf ) );
+  tx.count = 0;
+
+  /* multi frame, segments split across frame boundaries */
+  const IsoTpIoVec iov[ 3 ] = { { header, sizeof( header ) }, { nullptr, 0 }, { body, sizeof( body ) } };
+  ENUMS_EQUAL_INT( isotp_sendv( g_link, iov, 3 ), ISOTP_RET_OK );
+  for (int i = 0; i < 20 && g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+  wire_exchange( g_link, &tx, &receiver, &rx );
+
+  ENUMS_EQUAL_INT( g_link->send_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+  ENUMS_EQUAL_INT( receiver.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( sizeof( header ) + sizeof( body ), receiver.receive_size );
+  MEMCMP_EQUAL( header, receiver_buf, sizeof( header ) );
+  MEMCMP_EQUAL( body, receiver_buf + sizeof( header ), sizeof( body ) );
+}
+
+TEST(ISOTP_MULTIPLE, SendQueued)
+{
+  IsoTpLink receiver;
+  uint8_t receiver_buf[ ISOTP_BUFSIZE ];
+  IsoTpTxRequest slots[ 2 ];
+  const uint8_t short_frame[ 3 ] = { 0x3E, 0x00, 0x01 };
+  CallbackLog sent = {};
+  CallbackLog received = {};
+  FdWire tx = {};
+  FdWire rx = {};
+
+  isotp_init_link_static( &receiver, ISOTP_CAN_ID + 8, NULL, 0, receiver_buf, sizeof( receiver_buf ) );
+  isotp_set_user_ops( &receiver, &fd_wire_ops, &rx );
+  isotp_set_callbacks( &receiver, &log_callbacks, &received );
+  isotp_set_user_ops( g_link, &fd_wire_ops, &tx );
+  isotp_set_callbacks( g_link, &log_callbacks, &sent );
+
+  ENUMS_EQUAL_INT( isotp_set_tx_queue( g_link, slots, 3 ), ISOTP_RET_ERROR );
+  ENUMS_EQUAL_INT( isotp_set_tx_queue( g_link, slots, 2 ), ISOTP_RET_OK );
+
+  /* first message starts at once, the others wait */
+  ENUMS_EQUAL_INT( isotp_send_queued( g_link, send_multi_frame, sizeof( send_multi_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send_queued( g_link, short_frame, sizeof( short_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send_queued( g_link, send_multi_frame, sizeof( send_multi_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send_queued( g_link, short_frame, sizeof( short_frame ) ), ISOTP_RET_OVERFLOW );
+  LONGS_EQUAL( 1, tx.count );
+  LONGS_EQUAL( 2, g_link->tx_queue_count );
+
+  for (int i = 0; i < 10 && 0 == sent.confirms; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+
+  /* the poll finishing the first message sends the next two right away */
+  LONGS_EQUAL( 2, sent.confirms );
+  LONGS_EQUAL( 3, tx.count );
+  LONGS_EQUAL( 0x21, tx.data[0][0] );
+  LONGS_EQUAL( 0x03, tx.data[1][0] );
+  LONGS_EQUAL( 0x10, tx.data[2][0] );
+  LONGS_EQUAL( 0, g_link->tx_queue_count );
+
+  for (int i = 0; i < 10 && g_link->send_status == ISOTP_SEND_STATUS_INPROGRESS; i++)
+  {
+    wire_exchange( g_link, &tx, &receiver, &rx );
+  }
+  wire_exchange( g_link, &tx, &receiver, &rx );
+
+  LONGS_EQUAL( 3, sent.confirms );
+  ENUMS_EQUAL_INT( sent.confirm_result, ISOTP_PROTOCOL_RESULT_OK );
+  LONGS_EQUAL( 3, received.indications );
+  LONGS_EQUAL( sizeof( send_multi_frame ), received.indication_size );
+}
+
 TEST(ISOTP_MULTIPLE, SendMultiFrameTimeOut)
 {
 
@@ -247,6 +1046,9 @@ TEST(ISOTP_MULTIPLE, ReceiveMultiFrameTimeOut)
     LONGS_EQUAL( g_link->receive_size, first_multi_frame[1] );
     LONGS_EQUAL( g_link->receive_offset, 6 );    
 
+    CallbackLog log = {};
+    isotp_set_callbacks( g_link, &log_callbacks, &log );
+
     while( g_link->receive_status != ISOTP_RECEIVE_STATUS_IDLE )
     {
       isotp_poll( g_link );
@@ -254,6 +1056,10 @@ TEST(ISOTP_MULTIPLE, ReceiveMultiFrameTimeOut)
 
     ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
     ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+    LONGS_EQUAL( log.indications, 1 );
+    ENUMS_EQUAL_INT( log.indication_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+    LONGS_EQUAL( log.indication_size, 0 );
+    isotp_set_callbacks( g_link, NULL, NULL );
 
     /* -------------------------- Receive Multi Frame -------------------------- */ 
 
@@ -283,7 +1089,7 @@ TEST(ISOTP_MULTIPLE, ReceiveMultiFrameTimeOut)
     ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
     ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
 
-    uint16_t out_size = 0;
+    uint32_t out_size = 0;
     uint8_t payload[ 10 ] = { 0 };
     int ret_outbuf = isotp_receive(g_link, payload, sizeof( payload ), &out_size);
     ENUMS_EQUAL_INT( ret_outbuf, ISOTP_RET_OK );
@@ -0,0 +1,27 @@
+#ifndef __ISOTP_CPPUTEST_NULL_BUS_HPP__
+#define __ISOTP_CPPUTEST_NULL_BUS_HPP__
+
+#include <stdint.h>
+#include "isotp.h"
+
+/* Transport for tests that drive links without checking the wire: every
+ * frame is accepted and dropped, the clock is the uint32_t the user
+ * context points to (0 if the context is NULL). */
+
+static inline int null_bus_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
+{
+  (void)ctx;
+  (void)arbitration_id;
+  (void)data;
+  (void)size;
+  return ISOTP_RET_OK;
+}
+
+static inline uint32_t null_bus_get_us(void *ctx)
+{
+  return (ctx != NULL) ? *(const uint32_t *)ctx : 0;
+}
+
+static const IsoTpUserOps null_bus_ops = { null_bus_send_can, null_bus_get_us, NULL };
+
+#endif /* __ISOTP_CPPUTEST_NULL_BUS_HPP__ */
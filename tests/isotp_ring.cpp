@@ -0,0 +1,160 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_null_bus.hpp"
+#include "isotp_ring.h"
+
+#include <thread>
+
+#define ISOTP_CAN_ID        ( 0x700 )
+#define ISOTP_BUFSIZE       ( 64 )
+#define ISOTP_RING_SIZE     ( 16 )
+
+TEST_GROUP(ISOTP_RING)
+{
+  IsoTpFrameRing g_ring;
+  IsoTpCanFrame g_frames[ISOTP_RING_SIZE];
+
+  void setup()
+  {
+    LONGS_EQUAL( isotp_frame_ring_init(&g_ring, g_frames, ISOTP_RING_SIZE), ISOTP_RET_OK );
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_RING, Init)
+{
+  IsoTpFrameRing ring;
+
+  LONGS_EQUAL( isotp_frame_ring_init(&ring, g_frames, 12), ISOTP_RET_ERROR );
+  LONGS_EQUAL( isotp_frame_ring_init(&ring, g_frames, 1), ISOTP_RET_ERROR );
+
+  /* each side on its own cache line */
+  LONGS_EQUAL( 0, offsetof(IsoTpFrameRing, tail) % ISOTP_CACHE_LINE_SIZE );
+  LONGS_EQUAL( 0, offsetof(IsoTpFrameRing, head) % ISOTP_CACHE_LINE_SIZE );
+  CHECK( offsetof(IsoTpFrameRing, head) - offsetof(IsoTpFrameRing, tail) >= ISOTP_CACHE_LINE_SIZE );
+  POINTERS_EQUAL( NULL, isotp_frame_ring_front(&g_ring) );
+}
+
+TEST(ISOTP_RING, PushFull)
+{
+  uint8_t data[ 8 ] = { 0 };
+
+  /* wraps the indices several times */
+  for (uint32_t round = 0; round < 5; round++)
+  {
+    for (uint32_t i = 0; i < ISOTP_RING_SIZE; i++)
+    {
+      data[0] = (uint8_t)i;
+      LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID, data, sizeof( data )), ISOTP_RET_OK );
+    }
+    LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID, data, sizeof( data )), ISOTP_RET_OVERFLOW );
+
+    for (uint32_t i = 0; i < ISOTP_RING_SIZE; i++)
+    {
+      const IsoTpCanFrame *frame = isotp_frame_ring_front(&g_ring);
+      CHECK( frame != NULL );
+      LONGS_EQUAL( i, frame->data[0] );
+      LONGS_EQUAL( 8, frame->len );
+      isotp_frame_ring_release(&g_ring);
+    }
+    POINTERS_EQUAL( NULL, isotp_frame_ring_front(&g_ring) );
+  }
+
+  uint8_t too_long[ ISO_TP_MAX_FRAME_SIZE + 1 ] = { 0 };
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID, too_long, sizeof( too_long )), ISOTP_RET_LENGTH );
+}
+
+TEST(ISOTP_RING, DrainIntoLink)
+{
+  IsoTpLink link;
+  uint8_t recv_buf[ ISOTP_BUFSIZE ];
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  const uint8_t consecutive_frame[ 4 ] = { 0x21, 0x07, 0x08, 0x09 };
+
+  isotp_init_link_static(&link, ISOTP_CAN_ID, NULL, 0, recv_buf, sizeof( recv_buf ));
+  isotp_set_user_ops(&link, &null_bus_ops, NULL);
+
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 8, first_frame, sizeof( first_frame )), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 8, consecutive_frame, sizeof( consecutive_frame )), ISOTP_RET_OK );
+
+  LONGS_EQUAL( 1, isotp_frame_ring_drain(&g_ring, &link, 1) );
+  ENUMS_EQUAL_INT( link.receive_status, ISOTP_RECEIVE_STATUS_INPROGRESS );
+  LONGS_EQUAL( 1, isotp_frame_ring_drain(&g_ring, &link, 8) );
+  ENUMS_EQUAL_INT( link.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( 9, link.receive_size );
+  LONGS_EQUAL( 0, isotp_frame_ring_drain(&g_ring, &link, 8) );
+}
+
+TEST(ISOTP_RING, DrainSkipsOtherIds)
+{
+  IsoTpLink link;
+  uint8_t recv_buf[ ISOTP_BUFSIZE ];
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  const uint8_t consecutive_frame[ 4 ] = { 0x21, 0x07, 0x08, 0x09 };
+
+  isotp_init_link_static(&link, ISOTP_CAN_ID, NULL, 0, recv_buf, sizeof( recv_buf ));
+  isotp_set_user_ops(&link, &null_bus_ops, NULL);
+  isotp_set_rx_id(&link, ISOTP_CAN_ID + 8);
+
+  /* frames of another ID leave the link alone, and move the ring close to its end */
+  for (int i = 0; i < ISOTP_RING_SIZE - 2; i++)
+  {
+    LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 9, first_frame, sizeof( first_frame )), ISOTP_RET_OK );
+  }
+  LONGS_EQUAL( ISOTP_RING_SIZE - 2, isotp_frame_ring_drain(&g_ring, &link, ISOTP_RING_SIZE) );
+  ENUMS_EQUAL_INT( link.receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+
+  /* the message wraps around the end of the ring, with a foreign frame in between */
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 8, first_frame, sizeof( first_frame )), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 9, consecutive_frame, sizeof( consecutive_frame )), ISOTP_RET_OK );
+  LONGS_EQUAL( isotp_frame_ring_push(&g_ring, ISOTP_CAN_ID + 8, consecutive_frame, sizeof( consecutive_frame )), ISOTP_RET_OK );
+
+  LONGS_EQUAL( 3, isotp_frame_ring_drain(&g_ring, &link, 8) );
+  ENUMS_EQUAL_INT( link.receive_status, ISOTP_RECEIVE_STATUS_FULL );
+  LONGS_EQUAL( 9, link.receive_size );
+  ENUMS_EQUAL_INT( link.receive_protocol_result, ISOTP_PROTOCOL_RESULT_OK );
+}
+
+TEST(ISOTP_RING, ProducerThread)
+{
+  const uint32_t total = 200000;
+  uint32_t received = 0;
+  uint32_t out_of_order = 0;
+
+  /* RX thread pushes numbered frames, retrying while the ring is full */
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < total; i++)
+    {
+      while (ISOTP_RET_OVERFLOW == isotp_frame_ring_push(&g_ring, i, (const uint8_t *)&i, sizeof( i )))
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  while (received < total)
+  {
+    const IsoTpCanFrame *frame = isotp_frame_ring_front(&g_ring);
+    if (frame == NULL)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    uint32_t value;
+    memcpy( &value, frame->data, sizeof( value ) );
+    if (value != received || frame->arbitration_id != received)
+    {
+      out_of_order++;
+    }
+    isotp_frame_ring_release(&g_ring);
+    received++;
+  }
+
+  producer.join();
+  LONGS_EQUAL( 0, out_of_order );
+}
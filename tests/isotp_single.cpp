@@ -6,9 +6,35 @@
 #define ISOTP_CAN_ID        ( 0x700 )
 #define ISOTP_BUFSIZE       ( 128 )
 
+/* Per-link transport, counts frames sent on its bus */
+typedef struct {
+  int frames;
+  uint32_t last_id;
+  uint8_t last_size;
+} TestBus;
+
+static int test_bus_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
+{
+  TestBus *bus = (TestBus *)ctx;
+  (void)data;
+  bus->frames++;
+  bus->last_id = arbitration_id;
+  bus->last_size = size;
+  return ISOTP_RET_OK;
+}
+
+static uint32_t test_bus_get_us(void *ctx)
+{
+  (void)ctx;
+  return 0;
+}
+
+static const IsoTpUserOps test_bus_ops = { test_bus_send_can, test_bus_get_us, NULL };
+
 TEST_GROUP(ISOTP_SINGLE)
 {
   /* Alloc IsoTpLink statically in RAM */
+  IsoTpLink g_linkStorage;
   IsoTpLink *g_link = nullptr;
   /* Alloc send and receive buffer statically in RAM */
   uint8_t g_isotpRecvBuf[ISOTP_BUFSIZE];
@@ -17,13 +43,13 @@ TEST_GROUP(ISOTP_SINGLE)
   void setup()
   {
     /* Initialize link, ISOTP_CAN_ID is the CAN ID you send with */
-    g_link = isotp_init_link(ISOTP_CAN_ID,
+    g_link = &g_linkStorage;
+    isotp_init_link_static(g_link, ISOTP_CAN_ID,
 						g_isotpSendBuf, sizeof(g_isotpSendBuf),
 						g_isotpRecvBuf, sizeof(g_isotpRecvBuf));
   }
   void teardown()
   {
-    free( g_link );
     mock().clear();
   }
 };
@@ -55,7 +81,7 @@ TEST(ISOTP_SINGLE, Create)
   ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
 
   /* receiver paramters */
-  LONGS_EQUAL( g_link->receive_arbitration_id, 0 );
+  LONGS_EQUAL( g_link->receive_arbitration_id, ISOTP_NO_RX_ID );
 
   /* message buffer */
   CHECK( g_link->receive_buffer != nullptr );
@@ -88,12 +114,12 @@ TEST(ISOTP_SINGLE, ReceiveSingleFrame)
     LONGS_EQUAL( g_link->receive_size, x );
 
     uint8_t payload[ 7 ] = { 0 };
-    uint16_t out_size = 0;
+    uint32_t out_size = 0;
     int ret_receive = isotp_receive(g_link, payload, sizeof(payload), &out_size);
     ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
     ENUMS_EQUAL_INT( ret_receive, ISOTP_RET_OK );
     LONGS_EQUAL(out_size, x );
-    for(int i = 0; i < out_size; i++)
+    for(uint32_t i = 0; i < out_size; i++)
     {
       LONGS_EQUAL(payload[i], single_frame[i+1]);
     }
@@ -115,7 +141,7 @@ TEST(ISOTP_SINGLE, ReceiveShortSingleFrame)
   LONGS_EQUAL( g_link->receive_size, 0 );
 
   uint8_t payload[ 7 ] = { 0 };
-  uint16_t out_size = 0;
+  uint32_t out_size = 0;
   int ret_receive = isotp_receive(g_link, payload, sizeof(payload), &out_size);
   ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
   ENUMS_EQUAL_INT( ret_receive, ISOTP_RET_NO_DATA );
@@ -138,7 +164,7 @@ TEST(ISOTP_SINGLE, ReceiveLongSingleFrame)
   LONGS_EQUAL( g_link->receive_size, 0 );
 
   uint8_t payload[ 7 ] = { 0 };
-  uint16_t out_size = 0;
+  uint32_t out_size = 0;
   int ret_receive = isotp_receive(g_link, payload, sizeof(payload), &out_size);
   ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
   ENUMS_EQUAL_INT( ret_receive, ISOTP_RET_NO_DATA );
@@ -159,7 +185,7 @@ TEST(ISOTP_SINGLE, RecieveBufferSmall)
   LONGS_EQUAL( g_link->receive_size, sizeof( single_frame ) - 1 );
 
   uint8_t payload[ 5 ] = { 0 };
-  uint16_t out_size = 0;
+  uint32_t out_size = 0;
   mock().expectOneCall("isotp_user_debug");
   int ret_receive = isotp_receive(g_link, payload, sizeof(payload), &out_size);
   mock().checkExpectations();
@@ -182,4 +208,205 @@ TEST(ISOTP_SINGLE, SendSingleFrame)
   LONGS_EQUAL( g_link->send_arbitration_id, ISOTP_CAN_ID );
 
   mock().checkExpectations();
-}
\ No newline at end of file
+}
+
+TEST(ISOTP_SINGLE, SendEmpty)
+{
+  const uint8_t single_frame[ 1 ] = { 0x01 };
+
+  /* no SF with SF_DL 0 goes out */
+  mock().expectNCalls(3, "isotp_user_debug");
+  ENUMS_EQUAL_INT( isotp_send(g_link, single_frame, 0), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( isotp_send_nocopy(g_link, single_frame, 0), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( isotp_sendv(g_link, NULL, 0), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
+
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_SINGLE, SendSingleFrameNoSendBuffer)
+{
+  const uint8_t single_frame[ 7 ] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+
+  IsoTpLink link_storage;
+  IsoTpLink *link = &link_storage;
+  isotp_init_link_static(link, ISOTP_CAN_ID, NULL, 0, g_isotpRecvBuf, sizeof(g_isotpRecvBuf));
+
+  mock().expectNCalls(2, "isotp_user_debug");
+  int ret = isotp_send(link, single_frame, sizeof( single_frame ) );
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_OVERFLOW );
+  mock().checkExpectations();
+
+  mock().expectOneCall("isotp_user_send_can");
+  ret = isotp_send_nocopy(link, single_frame, sizeof( single_frame ) );
+  ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( link->send_status, ISOTP_SEND_STATUS_IDLE );
+  CHECK_TRUE( isotp_send_buffer_released( link ) );
+  mock().checkExpectations();
+}
+
+TEST(ISOTP_SINGLE, ReceiveSingleFrameLease)
+{
+  const uint8_t single_frame[ 8 ] = { 0x07, 0x05, 0x0A, 0x05, 0x04, 0x03, 0x05, 0x0A };
+
+  int ret_msg_can = isotp_on_can_message(g_link, single_frame, sizeof( single_frame ));
+  ENUMS_EQUAL_INT( ret_msg_can, ISOTP_RET_OK );
+
+  const uint8_t *payload = nullptr;
+  uint32_t out_size = 0;
+  int ret_lease = isotp_receive_lease(g_link, &payload, &out_size);
+  ENUMS_EQUAL_INT( ret_lease, ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_LEASED );
+  POINTERS_EQUAL( payload, g_isotpRecvBuf );
+  LONGS_EQUAL( out_size, 7 );
+  MEMCMP_EQUAL( payload, single_frame + 1, out_size );
+
+  /* Leased buffer is not overwritten */
+  mock().expectOneCall("isotp_user_debug");
+  const uint8_t other_frame[ 3 ] = { 0x02, 0xFF, 0xFF };
+  ret_msg_can = isotp_on_can_message(g_link, other_frame, sizeof( other_frame ));
+  ENUMS_EQUAL_INT( ret_msg_can, ISOTP_RET_OVERFLOW );
+  ENUMS_EQUAL_INT( g_link->receive_protocol_result, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW );
+  MEMCMP_EQUAL( payload, single_frame + 1, out_size );
+  mock().checkExpectations();
+
+  ENUMS_EQUAL_INT( isotp_receive_release(g_link), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  ENUMS_EQUAL_INT( isotp_receive_release(g_link), ISOTP_RET_NO_DATA );
+  ENUMS_EQUAL_INT( isotp_receive_lease(g_link, &payload, &out_size), ISOTP_RET_NO_DATA );
+}
+
+TEST(ISOTP_SINGLE, SendSingleFrameUserOps)
+{
+  const uint8_t single_frame[ 3 ] = { 0x01, 0x02, 0x03 };
+  TestBus bus_a = {};
+  TestBus bus_b = {};
+
+  IsoTpLink link_b_storage;
+  IsoTpLink *link_b = &link_b_storage;
+  isotp_init_link_static(link_b, ISOTP_CAN_ID + 1, g_isotpSendBuf, sizeof(g_isotpSendBuf), g_isotpRecvBuf, sizeof(g_isotpRecvBuf));
+  isotp_set_user_ops(g_link, &test_bus_ops, &bus_a);
+  isotp_set_user_ops(link_b, &test_bus_ops, &bus_b);
+
+  /* No call reaches the global isotp_user_* functions */
+  ENUMS_EQUAL_INT( isotp_send(g_link, single_frame, sizeof( single_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send(link_b, single_frame, sizeof( single_frame ) ), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send(link_b, single_frame, sizeof( single_frame ) ), ISOTP_RET_OK );
+
+  LONGS_EQUAL( bus_a.frames, 1 );
+  LONGS_EQUAL( bus_a.last_id, ISOTP_CAN_ID );
+  LONGS_EQUAL( bus_a.last_size, 4 );
+  LONGS_EQUAL( bus_b.frames, 2 );
+  LONGS_EQUAL( bus_b.last_id, ISOTP_CAN_ID + 1 );
+
+  /* NULL restores the global functions */
+  isotp_set_user_ops(g_link, NULL, NULL);
+  POINTERS_EQUAL( g_link->user_ops, &isotp_user_default_ops );
+  mock().expectOneCall("isotp_user_send_can");
+  ENUMS_EQUAL_INT( isotp_send(g_link, single_frame, sizeof( single_frame ) ), ISOTP_RET_OK );
+  mock().checkExpectations();
+
+}
+
+TEST(ISOTP_SINGLE, CreateStatic)
+{
+  /* links laid out contiguously in one arena */
+  static IsoTpLink arena[ 4 ];
+  const uint8_t single_frame[ 3 ] = { 0x02, 0x0A, 0x0B };
+
+  LONGS_EQUAL( ISOTP_LINK_SIZE, sizeof( IsoTpLink ) );
+  LONGS_EQUAL( 0, ((uintptr_t)&arena[1]) % ISOTP_LINK_ALIGN );
+
+  memset( arena, 0xA5, sizeof( arena ) );
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    int ret = isotp_init_link_static(&arena[i], ISOTP_CAN_ID + i, NULL, 0, g_isotpRecvBuf, sizeof(g_isotpRecvBuf));
+    ENUMS_EQUAL_INT( ret, ISOTP_RET_OK );
+  }
+
+  LONGS_EQUAL( arena[2].send_arbitration_id, ISOTP_CAN_ID + 2 );
+  POINTERS_EQUAL( arena[2].receive_buffer, g_isotpRecvBuf );
+  LONGS_EQUAL( arena[2].send_offset, 0 );
+  LONGS_EQUAL( arena[2].receive_timer_cr, 0 );
+  ENUMS_EQUAL_INT( arena[2].send_status, ISOTP_SEND_STATUS_IDLE );
+  ENUMS_EQUAL_INT( arena[2].receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+
+  int ret_msg_can = isotp_on_can_message(&arena[3], single_frame, sizeof( single_frame ));
+  ENUMS_EQUAL_INT( ret_msg_can, ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( arena[3].receive_status, ISOTP_RECEIVE_STATUS_FULL );
+}
+
+TEST(ISOTP_SINGLE, Layout)
+{
+  /* sender and receiver never share a cache line */
+  CHECK( sizeof( IsoTpLink ) <= ISO_TP_LINK_SIZE_BUDGET );
+  LONGS_EQUAL( 0, offsetof(IsoTpLink, send_status) % ISOTP_CACHE_LINE_SIZE );
+  LONGS_EQUAL( 0, offsetof(IsoTpLink, receive_status) % ISOTP_CACHE_LINE_SIZE );
+  CHECK( offsetof(IsoTpLink, send_iov_count) < offsetof(IsoTpLink, receive_status) );
+  /* the timer is written by both, it shares a line with neither */
+  LONGS_EQUAL( 0, offsetof(IsoTpLink, timer) % ISOTP_CACHE_LINE_SIZE );
+  CHECK( offsetof(IsoTpLink, timer) > offsetof(IsoTpLink, receive_arbitration_id) );
+  CHECK( offsetof(IsoTpLink, timer_wheel) < offsetof(IsoTpLink, user_ops) );
+}
+
+#if !ISO_TP_NO_HEAP
+TEST(ISOTP_SINGLE, CreateHeap)
+{
+  IsoTpLink *link = isotp_init_link(ISOTP_CAN_ID, g_isotpSendBuf, sizeof(g_isotpSendBuf), g_isotpRecvBuf, sizeof(g_isotpRecvBuf));
+  CHECK( link != nullptr );
+
+  /* heap links keep the alignment */
+  LONGS_EQUAL( 0, ((uintptr_t)link) % ISOTP_LINK_ALIGN );
+  LONGS_EQUAL( link->send_arbitration_id, ISOTP_CAN_ID );
+  POINTERS_EQUAL( link->receive_buffer, g_isotpRecvBuf );
+
+  isotp_free_link( link );
+}
+#endif
+
+TEST(ISOTP_SINGLE, CanFdSingleFrame)
+{
+  uint8_t payload[ 20 ];
+  TestBus bus = {};
+
+  for (uint8_t i = 0; i < sizeof( payload ); i++)
+  {
+    payload[i] = i;
+  }
+
+  /* escaped single frame, 22 bytes padded to the next CAN FD length */
+  isotp_set_user_ops(g_link, &test_bus_ops, &bus);
+  ENUMS_EQUAL_INT( isotp_set_tx_dl(g_link, 32), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( isotp_send(g_link, payload, sizeof( payload ) ), ISOTP_RET_OK );
+  LONGS_EQUAL( bus.frames, 1 );
+  LONGS_EQUAL( bus.last_size, 24 );
+  ENUMS_EQUAL_INT( g_link->send_status, ISOTP_SEND_STATUS_IDLE );
+
+  /* invalid data lengths */
+  ENUMS_EQUAL_INT( isotp_set_tx_dl(g_link, 10), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( isotp_set_tx_dl(g_link, 4), ISOTP_RET_LENGTH );
+  LONGS_EQUAL( g_link->send_tx_dl, 32 );
+
+  /* receive escaped single frame */
+  uint8_t frame[ 24 ] = { 0x00, sizeof( payload ) };
+  memcpy( frame + 2, payload, sizeof( payload ) );
+  ENUMS_EQUAL_INT( isotp_on_can_message(g_link, frame, sizeof( frame )), ISOTP_RET_OK );
+  ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_FULL );
+
+  uint8_t out[ 64 ] = { 0 };
+  uint32_t out_size = 0;
+  ENUMS_EQUAL_INT( isotp_receive(g_link, out, sizeof( out ), &out_size), ISOTP_RET_OK );
+  LONGS_EQUAL( out_size, sizeof( payload ) );
+  MEMCMP_EQUAL( payload, out, sizeof( payload ) );
+
+  /* escape claiming more than the frame carries */
+  frame[1] = 23;
+  ENUMS_EQUAL_INT( isotp_on_can_message(g_link, frame, sizeof( frame )), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+
+  /* frames longer than 8 bytes must use the escape, SF_DL in the nibble is rejected */
+  frame[0] = 0x05;
+  frame[1] = 0x00;
+  ENUMS_EQUAL_INT( isotp_on_can_message(g_link, frame, sizeof( frame )), ISOTP_RET_LENGTH );
+  ENUMS_EQUAL_INT( g_link->receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+}
@@ -0,0 +1,177 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_submit.h"
+
+#include <thread>
+#include <vector>
+
+#define ISOTP_CAN_ID        ( 0x700 )
+#define ISOTP_BUFSIZE       ( 64 )
+#define SUBMIT_PRODUCERS    ( 4 )
+
+/* records what the protocol thread puts on the bus */
+typedef struct {
+  uint32_t frames;
+  uint8_t last[ ISO_TP_MAX_FRAME_SIZE ];
+  uint32_t next_seq[ SUBMIT_PRODUCERS ];
+  uint32_t out_of_order;
+} SubmitBus;
+
+static int submit_bus_send_can(void *ctx, const uint32_t arbitration_id, const uint8_t* data, const uint8_t size)
+{
+  SubmitBus *bus = (SubmitBus *)ctx;
+  (void)arbitration_id;
+
+  memcpy( bus->last, data, size );
+  bus->frames++;
+
+  /* single frames of the producer threads carry { producer, seq low, seq high } */
+  if ((data[0] & 0xF0) == 0 && data[1] < SUBMIT_PRODUCERS)
+  {
+    const uint32_t seq = data[2] | (data[3] << 8);
+    if (seq != bus->next_seq[data[1]])
+    {
+      bus->out_of_order++;
+    }
+    bus->next_seq[data[1]] = seq + 1;
+  }
+  return ISOTP_RET_OK;
+}
+
+static uint32_t submit_bus_get_us(void *ctx)
+{
+  (void)ctx;
+  return 0;
+}
+
+static const IsoTpUserOps submit_bus_ops = { submit_bus_send_can, submit_bus_get_us, NULL };
+
+TEST_GROUP(ISOTP_SUBMIT)
+{
+  IsoTpSubmitQueue g_queue;
+  IsoTpLink g_link;
+  SubmitBus g_bus;
+  uint8_t g_recv_buf[ ISOTP_BUFSIZE ];
+
+  void setup()
+  {
+    memset( &g_bus, 0, sizeof( g_bus ) );
+    isotp_submit_queue_init(&g_queue);
+    isotp_init_link_static(&g_link, ISOTP_CAN_ID, NULL, 0, g_recv_buf, sizeof( g_recv_buf ));
+    isotp_set_user_ops(&g_link, &submit_bus_ops, &g_bus);
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_SUBMIT, Init)
+{
+  /* producers and the consumer on their own cache lines */
+  CHECK( offsetof(IsoTpSubmitQueue, head) - offsetof(IsoTpSubmitQueue, tail) >= ISOTP_CACHE_LINE_SIZE );
+  LONGS_EQUAL( 0, isotp_submit_queue_drain(&g_queue, 8) );
+}
+
+TEST(ISOTP_SUBMIT, QueuedBehindMultiFrame)
+{
+  IsoTpTxRequest slots[ 2 ];
+  IsoTpSubmission first, second;
+  uint8_t long_payload[ 20 ] = { 0 };
+  const uint8_t short_payload[ 3 ] = { 0xA1, 0xA2, 0xA3 };
+  const uint8_t flow_control[ 3 ] = { 0x30, 0x00, 0x00 };
+
+  LONGS_EQUAL( isotp_set_tx_queue(&g_link, slots, 2), ISOTP_RET_OK );
+
+  isotp_submit(&g_queue, &first, &g_link, ISOTP_CAN_ID, long_payload, sizeof( long_payload ));
+  isotp_submit(&g_queue, &second, &g_link, ISOTP_CAN_ID, short_payload, sizeof( short_payload ));
+  LONGS_EQUAL( 2, isotp_submit_queue_drain(&g_queue, 8) );
+
+  /* first frame sent, the single frame waits in the transmit queue */
+  LONGS_EQUAL( 1, g_bus.frames );
+  CHECK_FALSE( isotp_submission_done(&first) );
+  CHECK_FALSE( isotp_submission_done(&second) );
+  LONGS_EQUAL( 1, g_link.tx_queue_count );
+
+  LONGS_EQUAL( isotp_on_can_message(&g_link, flow_control, sizeof( flow_control )), ISOTP_RET_OK );
+  for (int i = 0; i < 8 && !isotp_submission_done(&second); i++)
+  {
+    isotp_poll(&g_link);
+  }
+
+  CHECK( isotp_submission_done(&first) );
+  LONGS_EQUAL( first.completion.status, ISOTP_RET_OK );
+  LONGS_EQUAL( first.completion.result, ISOTP_PROTOCOL_RESULT_OK );
+  CHECK( isotp_submission_done(&second) );
+  LONGS_EQUAL( second.completion.result, ISOTP_PROTOCOL_RESULT_OK );
+  LONGS_EQUAL( 0x03, g_bus.last[0] );
+  LONGS_EQUAL( 0xA1, g_bus.last[1] );
+}
+
+TEST(ISOTP_SUBMIT, RefusedWithoutTxQueue)
+{
+  IsoTpSubmission first, second;
+  uint8_t long_payload[ 20 ] = { 0 };
+  const uint8_t short_payload[ 3 ] = { 0 };
+
+  isotp_submit(&g_queue, &first, &g_link, ISOTP_CAN_ID, long_payload, sizeof( long_payload ));
+  isotp_submit(&g_queue, &second, &g_link, ISOTP_CAN_ID, short_payload, sizeof( short_payload ));
+  LONGS_EQUAL( 1, isotp_submit_queue_drain(&g_queue, 1) );
+  LONGS_EQUAL( 1, isotp_submit_queue_drain(&g_queue, 8) );
+
+  /* the link is busy and cannot queue, the second send is reported as refused */
+  CHECK_FALSE( isotp_submission_done(&first) );
+  CHECK( isotp_submission_done(&second) );
+  LONGS_EQUAL( second.completion.status, ISOTP_RET_OVERFLOW );
+  LONGS_EQUAL( second.completion.result, ISOTP_PROTOCOL_RESULT_ERROR );
+}
+
+TEST(ISOTP_SUBMIT, ProducerThreads)
+{
+  typedef struct {
+    IsoTpSubmission submission;
+    uint8_t payload[ 3 ];
+  } Send;
+
+  const uint32_t per_producer = 20000;
+  const uint32_t total = SUBMIT_PRODUCERS * per_producer;
+  std::vector<Send> sends( total );
+  std::vector<std::thread> producers;
+
+  /* application threads submit numbered single frames concurrently */
+  for (uint32_t p = 0; p < SUBMIT_PRODUCERS; p++)
+  {
+    producers.push_back(std::thread([&, p]() {
+      for (uint32_t i = 0; i < per_producer; i++)
+      {
+        Send *send = &sends[p * per_producer + i];
+        send->payload[0] = (uint8_t)p;
+        send->payload[1] = (uint8_t)i;
+        send->payload[2] = (uint8_t)(i >> 8);
+        isotp_submit(&g_queue, &send->submission, &g_link, ISOTP_CAN_ID, send->payload, sizeof( send->payload ));
+      }
+    }));
+  }
+
+  /* protocol thread */
+  while (g_bus.frames < total)
+  {
+    if (0 == isotp_submit_queue_drain(&g_queue, 64))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  for (std::thread &producer : producers)
+  {
+    producer.join();
+  }
+
+  LONGS_EQUAL( 0, g_bus.out_of_order );
+  LONGS_EQUAL( 0, isotp_submit_queue_drain(&g_queue, 64) );
+  for (uint32_t i = 0; i < total; i++)
+  {
+    CHECK( isotp_submission_done(&sends[i].submission) );
+  }
+}
@@ -0,0 +1,106 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_null_bus.hpp"
+#include "isotp_table.h"
+
+#define ISOTP_CAN_ID        ( 0x700 )
+#define ISOTP_BUFSIZE       ( 64 )
+#define TABLE_CAPACITY      ( 64 )
+#define TABLE_LINKS         ( 50 )
+
+static uint32_t g_table_now;
+
+TEST_GROUP(ISOTP_TABLE)
+{
+  IsoTpLinkTable g_table;
+  IsoTpLink* g_slots[ TABLE_CAPACITY ];
+  uint32_t g_deadlines[ TABLE_CAPACITY ];
+  uint32_t g_armed[ TABLE_CAPACITY ];
+  IsoTpLink g_links[ TABLE_LINKS ];
+  uint8_t g_recv_buf[ ISOTP_BUFSIZE ];
+
+  void setup()
+  {
+    g_table_now = 0;
+    LONGS_EQUAL( isotp_link_table_init(&g_table, g_slots, g_deadlines, g_armed, TABLE_CAPACITY), ISOTP_RET_OK );
+    for (uint32_t i = 0; i < TABLE_LINKS; i++)
+    {
+      isotp_init_link_static(&g_links[i], ISOTP_CAN_ID + i, NULL, 0, g_recv_buf, sizeof( g_recv_buf ));
+      isotp_set_user_ops(&g_links[i], &null_bus_ops, &g_table_now);
+      LONGS_EQUAL( (long)i, isotp_link_table_add(&g_table, &g_links[i]) );
+    }
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_TABLE, Init)
+{
+  IsoTpLinkTable table;
+
+  LONGS_EQUAL( isotp_link_table_init(&table, g_slots, g_deadlines, g_armed, 20), ISOTP_RET_ERROR );
+  LONGS_EQUAL( isotp_link_table_init(&table, g_slots, g_deadlines, g_armed, 32), ISOTP_RET_OK );
+  for (uint32_t i = 0; i < 32; i++)
+  {
+    LONGS_EQUAL( (long)i, isotp_link_table_add(&table, &g_links[0]) );
+  }
+  LONGS_EQUAL( isotp_link_table_add(&table, &g_links[0]), ISOTP_RET_OVERFLOW );
+}
+
+TEST(ISOTP_TABLE, ScanMatchesTimeAfter)
+{
+  uint32_t expired[ TABLE_CAPACITY / ISOTP_LINK_TABLE_WORD_BITS ];
+  const uint32_t base = 0xFFFF0000;
+
+  /* every third link idle, the others waiting for consecutive frames, deadlines across the clock wrap */
+  for (uint32_t i = 0; i < TABLE_LINKS; i++)
+  {
+    if (i % 3 != 0)
+    {
+      g_links[i].receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
+      g_links[i].receive_timer_cr = base + i * 2000;
+    }
+    isotp_link_table_sync(&g_table, i);
+  }
+
+  for (uint32_t now = base - 5000; now != base + 110000; now += 1000)
+  {
+    uint32_t count = 0;
+    uint32_t reference = isotp_link_table_scan(&g_table, now, expired);
+
+    for (uint32_t i = 0; i < TABLE_CAPACITY; i++)
+    {
+      uint32_t deadline;
+      const bool due = i < TABLE_LINKS &&
+                       ISOTP_RET_OK == isotp_next_deadline(&g_links[i], &deadline) &&
+                       !IsoTpTimeAfter(deadline, now);
+      const bool bit = (expired[i / 32] >> (i % 32)) & 1;
+
+      LONGS_EQUAL( due, bit );
+      count += due ? 1 : 0;
+    }
+    LONGS_EQUAL( count, reference );
+  }
+}
+
+TEST(ISOTP_TABLE, PollTimesOut)
+{
+  uint8_t payload[ 20 ] = { 0 };
+
+  ENUMS_EQUAL_INT( isotp_send_nocopy(&g_links[7], payload, sizeof( payload )), ISOTP_RET_OK );
+  isotp_link_table_sync(&g_table, 7);
+
+  /* waiting for the flow control */
+  g_table_now = ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+  LONGS_EQUAL( 0, isotp_link_table_poll(&g_table, g_table_now) );
+  ENUMS_EQUAL_INT( g_links[7].send_status, ISOTP_SEND_STATUS_INPROGRESS );
+
+  g_table_now += 1;
+  LONGS_EQUAL( 1, isotp_link_table_poll(&g_table, g_table_now) );
+  ENUMS_EQUAL_INT( g_links[7].send_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_BS );
+  LONGS_EQUAL( 0, g_armed[7] );
+  LONGS_EQUAL( 0, isotp_link_table_poll(&g_table, g_table_now) );
+}
@@ -7,7 +7,7 @@ int main(int ac, char **av)
 	if( ac < 2)
 	{
 		const char * av_override[] = { "exe", "-v", "-c" }; //turn on verbose mode
-		int ret = CommandLineTestRunner::RunAllTests(3, av_override);
+		ret = CommandLineTestRunner::RunAllTests(3, av_override);
 
 	} else {
 
@@ -0,0 +1,157 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "isotp.h"
+#include "isotp_null_bus.hpp"
+#include "isotp_timer.h"
+
+#define ISOTP_CAN_ID        ( 0x700 )
+#define ISOTP_BUFSIZE       ( 16 )
+#define ISOTP_LINKS         ( 100 )
+#define ISOTP_SLOTS         ( 64 )
+#define ISOTP_TICK_SHIFT    ( 10 )
+
+/* Clock shared by all links of the test bus */
+static uint32_t g_now_us;
+
+TEST_GROUP(ISOTP_TIMER)
+{
+  IsoTpTimerWheel g_wheel;
+  IsoTpTimer *g_slots[ISOTP_SLOTS];
+
+  IsoTpLink g_links[ISOTP_LINKS];
+  uint8_t g_isotpRecvBuf[ISOTP_LINKS][ISOTP_BUFSIZE];
+
+  const uint8_t first_frame[ 8 ] = { 0x10, 0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  const uint8_t send_payload[ 9 ] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 };
+
+  void setup()
+  {
+    /* start close to the wrap of the clock */
+    g_now_us = UINT32_MAX - 50000;
+    LONGS_EQUAL( isotp_timer_wheel_init(&g_wheel, g_slots, ISOTP_SLOTS, ISOTP_TICK_SHIFT, g_now_us), ISOTP_RET_OK );
+
+    for (int i = 0; i < ISOTP_LINKS; i++)
+    {
+      isotp_init_link_static(&g_links[i], ISOTP_CAN_ID + i, NULL, 0, g_isotpRecvBuf[i], ISOTP_BUFSIZE);
+      isotp_set_user_ops(&g_links[i], &null_bus_ops, &g_now_us);
+      isotp_timer_wheel_add_link(&g_wheel, &g_links[i]);
+    }
+  }
+  void teardown()
+  {
+    mock().clear();
+  }
+};
+
+TEST(ISOTP_TIMER, Init)
+{
+  IsoTpTimerWheel wheel;
+
+  LONGS_EQUAL( isotp_timer_wheel_init(&wheel, g_slots, 48, ISOTP_TICK_SHIFT, 0), ISOTP_RET_ERROR );
+  LONGS_EQUAL( g_wheel.count, 0 );
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us + 1000000), 0 );
+}
+
+TEST(ISOTP_TIMER, ReceiveTimeout)
+{
+  isotp_on_can_message(&g_links[3], first_frame, sizeof( first_frame ));
+  g_now_us += 20000;
+  isotp_on_can_message(&g_links[42], first_frame, sizeof( first_frame ));
+  LONGS_EQUAL( g_wheel.count, 2 );
+
+  /* nothing expires before N_Cr */
+  g_now_us += ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US - 20000;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), 0 );
+
+  /* only the first link times out, after the clock wrapped */
+  g_now_us += 1;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), 1 );
+  ENUMS_EQUAL_INT( g_links[3].receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  ENUMS_EQUAL_INT( g_links[3].receive_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+  ENUMS_EQUAL_INT( g_links[42].receive_status, ISOTP_RECEIVE_STATUS_INPROGRESS );
+  LONGS_EQUAL( g_wheel.count, 1 );
+
+  g_now_us += 20000;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), 1 );
+  ENUMS_EQUAL_INT( g_links[42].receive_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+  LONGS_EQUAL( g_wheel.count, 0 );
+}
+
+TEST(ISOTP_TIMER, SendStMin)
+{
+  const uint8_t flow_frame[ 3 ] = { 0x30, 0x00, 0x05 };
+
+  isotp_send_nocopy(&g_links[7], send_payload, sizeof( send_payload ));
+  LONGS_EQUAL( g_wheel.count, 1 );
+
+  /* flow control arms the timer for the consecutive frame */
+  isotp_on_can_message(&g_links[7], flow_frame, sizeof( flow_frame ));
+  g_now_us += 1000;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), 1 );
+  ENUMS_EQUAL_INT( g_links[7].send_status, ISOTP_SEND_STATUS_IDLE );
+  LONGS_EQUAL( g_links[7].send_offset, sizeof( send_payload ) );
+  LONGS_EQUAL( g_wheel.count, 0 );
+}
+
+TEST(ISOTP_TIMER, RemoveLink)
+{
+  isotp_on_can_message(&g_links[5], first_frame, sizeof( first_frame ));
+  LONGS_EQUAL( g_wheel.count, 1 );
+
+  isotp_timer_wheel_remove_link(&g_links[5]);
+  LONGS_EQUAL( g_wheel.count, 0 );
+  POINTERS_EQUAL( g_links[5].timer_wheel, nullptr );
+
+  g_now_us += 2 * ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), 0 );
+  ENUMS_EQUAL_INT( g_links[5].receive_status, ISOTP_RECEIVE_STATUS_INPROGRESS );
+}
+
+/* sends on the link given as context when a send of another link is confirmed */
+static void timer_confirm_send(IsoTpLink *link, void *ctx, int result)
+{
+  static const uint8_t request[ 2 ] = { 0x3E, 0x00 };
+  (void)link;
+  (void)result;
+  isotp_send_nocopy((IsoTpLink *)ctx, request, sizeof( request ));
+}
+
+static const IsoTpCallbacks timer_confirm_callbacks = { NULL, NULL, timer_confirm_send, NULL };
+
+TEST(ISOTP_TIMER, CallbackSendsDuringAdvance)
+{
+  /* all three expire in the same advance, the N_Bs timeout of the sender re-arms link 2 */
+  isotp_send_nocopy(&g_links[1], send_payload, sizeof( send_payload ));
+  isotp_on_can_message(&g_links[2], first_frame, sizeof( first_frame ));
+  isotp_on_can_message(&g_links[3], first_frame, sizeof( first_frame ));
+  isotp_set_callbacks(&g_links[1], &timer_confirm_callbacks, &g_links[2]);
+  LONGS_EQUAL( g_wheel.count, 3 );
+
+  g_now_us += ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US + 1;
+  CHECK( isotp_timer_wheel_advance(&g_wheel, g_now_us) >= 2 );
+  ENUMS_EQUAL_INT( g_links[1].send_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_BS );
+  ENUMS_EQUAL_INT( g_links[3].receive_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+
+  /* the re-armed link is still on the wheel and times out with the next advance */
+  g_now_us += 1 << ISOTP_TICK_SHIFT;
+  (void) isotp_timer_wheel_advance(&g_wheel, g_now_us);
+  ENUMS_EQUAL_INT( g_links[2].receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  ENUMS_EQUAL_INT( g_links[2].receive_protocol_result, ISOTP_PROTOCOL_RESULT_TIMEOUT_CR );
+  ENUMS_EQUAL_INT( g_links[3].receive_status, ISOTP_RECEIVE_STATUS_IDLE );
+  LONGS_EQUAL( g_wheel.count, 0 );
+}
+
+TEST(ISOTP_TIMER, BatchLimit)
+{
+  for (int i = 0; i < ISOTP_LINKS; i++)
+  {
+    isotp_on_can_message(&g_links[i], first_frame, sizeof( first_frame ));
+  }
+
+  /* the links beyond one batch time out with the next advance */
+  g_now_us += ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US + 1;
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), ISO_TP_TIMER_WHEEL_BATCH );
+  LONGS_EQUAL( g_wheel.count, ISOTP_LINKS - ISO_TP_TIMER_WHEEL_BATCH );
+  LONGS_EQUAL( isotp_timer_wheel_advance(&g_wheel, g_now_us), ISOTP_LINKS - ISO_TP_TIMER_WHEEL_BATCH );
+  LONGS_EQUAL( g_wheel.count, 0 );
+}